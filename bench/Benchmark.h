@@ -0,0 +1,72 @@
+#ifndef ROLL_BENCH_BENCHMARK_H_
+#define ROLL_BENCH_BENCHMARK_H_
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+
+/**
+ * Minimal benchmark harness that reports the results as JSON.
+ *
+ * Each case is run for a warm-up round (a tenth of the iterations) and then
+ * timed for the specified number of iterations. The results are written to
+ * the standard output as an array of objects, one for each case, containing
+ * the name of the case, the number of iterations and the time spent per item
+ * (an iteration may process many items, e.g. all the values in a buffer).
+ */
+class BenchmarkReport
+{
+    bool first = true;
+
+public:
+    inline BenchmarkReport() {
+        printf("[");
+    }
+
+    inline ~BenchmarkReport() {
+        printf("\n]\n");
+    }
+
+    BenchmarkReport(const BenchmarkReport&) = delete;
+
+    template<class F>
+    inline void run(const char* name, size_t iterations, F&& f, size_t itemsPerIteration = 1)
+    {
+        for(size_t i = 0; i < iterations / 10; i++)
+        {
+            f(i);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for(size_t i = 0; i < iterations; i++)
+        {
+            f(i);
+        }
+
+        const auto total = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        add(name, iterations, total / double(iterations * itemsPerIteration));
+    }
+
+    /**
+     * Report the result of a case measured by the caller (e.g. a throughput test).
+     */
+    inline void add(const char* name, size_t iterations, double nsPerOp)
+    {
+        printf("%s\n  {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f}",
+            first ? "" : ",", name, iterations, nsPerOp);
+
+        fflush(stdout);
+        first = false;
+    }
+};
+
+/**
+ * Make the compiler assume that the value is used, so that the computation of it is not optimized away.
+ */
+template<class T>
+inline void doNotOptimize(const T& v) {
+    asm volatile("" :: "r"(&v) : "memory");
+}
+
+#endif /* ROLL_BENCH_BENCHMARK_H_ */
@@ -0,0 +1,155 @@
+#include "Benchmark.h"
+
+#include "platform/FdStreamAdapter.h"
+#include "platform/StlAdapters.h"
+#include "platform/PagedRegistry.h"
+
+#include <deque>
+#include <thread>
+
+#include <sys/socket.h>
+
+using namespace rpc;
+
+/**
+ * Benchmarks of the method invocation.
+ *
+ * The dispatch of a received call message by Endpoint::process is measured
+ * in isolation (without any IO) with the different registry implementations,
+ * the full round trip of a call and its reply between two StlEndpoint objects
+ * is measured over a socketpair.
+ */
+
+/**
+ * IO engine that keeps the payloads of the sent messages, without doing any IO.
+ */
+class CapturingIo
+{
+public:
+    using InputAccessor = PreallocatedMemoryBufferStream::Accessor;
+
+    std::deque<std::vector<char>> sent;
+
+    inline auto messageFactory() {
+        return PreallocatedMemoryBufferStreamWriterFactory{};
+    }
+
+    inline bool send(PreallocatedMemoryBufferStream&& s)
+    {
+        auto a = s.access();
+        sent.emplace_back(a.ptr, a.end);
+        return true;
+    }
+};
+
+static constexpr auto addSymbol = symbol<uint32_t, uint32_t>("add"_ctstr);
+
+/**
+ * Process the sent messages by the sending endpoint itself, until there are no more.
+ */
+template<class Ep>
+static void loopback(Ep& ep)
+{
+    while(!ep.sent.empty())
+    {
+        auto m = std::move(ep.sent.front());
+        ep.sent.pop_front();
+
+        PreallocatedMemoryBufferStream::Accessor a(m.data(), m.data() + m.size());
+        ep.process(a);
+    }
+}
+
+template<template<class, class> class Registry>
+static void measureDispatch(BenchmarkReport& report, const char* name)
+{
+    using Ep = StlEndpoint<CapturingIo, Registry>;
+    Ep ep;
+
+    uint32_t sum = 0;
+    ep.provide(addSymbol, [&sum](Ep&, MethodHandle, uint32_t a, uint32_t b) { sum += a + b; });
+
+    /*
+     * Some unrelated registrations, so that the registry is not trivially small.
+     */
+    for(int i = 0; i < 100; i++)
+        ep.install([](Ep&, MethodHandle, uint32_t) {});
+
+    /*
+     * The call message is obtained by the endpoint looking up and calling its own method.
+     */
+    decltype(addSymbol)::CallType call;
+    ep.lookup(addSymbol, [&call](Ep&, bool, decltype(addSymbol)::CallType c) { call = c; });
+    loopback(ep);
+
+    ep.call(call, 1u, 2u);
+    const auto message = std::move(ep.sent.front());
+    ep.sent.clear();
+
+    report.run(name, 10000000, [&](size_t)
+    {
+        PreallocatedMemoryBufferStream::Accessor a(const_cast<char*>(message.data()), const_cast<char*>(message.data() + message.size()));
+        ep.process(a);
+    });
+
+    doNotOptimize(sum);
+}
+
+static void measureRoundTrip(BenchmarkReport& report)
+{
+    using Ep = StlEndpoint<FdStreamAdapter>;
+
+    int sv[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv))
+        return;
+
+    Ep client(sv[0], sv[0]), server(sv[1], sv[1]);
+
+    static constexpr auto echoSymbol = symbol<uint32_t, Call<uint32_t>>("echo"_ctstr);
+    server.provide(echoSymbol, [](Ep& ep, MethodHandle, uint32_t x, Call<uint32_t> reply) { ep.call(reply, x); });
+
+    std::thread serverThread([&server]
+    {
+        while(server.receive([&server](auto&& s) { auto a = s.access(); return !server.process(a); }));
+    });
+
+    auto receive = [&client]
+    {
+        return client.receive([&client](auto&& s) { auto a = s.access(); return !client.process(a); });
+    };
+
+    bool resolved = false;
+    decltype(echoSymbol)::CallType echo;
+    client.lookup(echoSymbol, [&](Ep&, bool ok, decltype(echoSymbol)::CallType c) { echo = c; resolved = ok; });
+
+    if(receive() && resolved)
+    {
+        uint32_t replies = 0;
+        auto reply = client.install([&replies](Ep&, MethodHandle, uint32_t) { replies++; });
+
+        report.run("roundtrip/fd_socketpair", 100000, [&](size_t i)
+        {
+            const auto expected = replies + 1;
+            client.call(echo, uint32_t(i), reply);
+
+            while(replies != expected && receive());
+        });
+    }
+
+    shutdown(sv[0], SHUT_RDWR);
+    serverThread.join();
+    close(sv[0]);
+    close(sv[1]);
+}
+
+int main()
+{
+    BenchmarkReport report;
+
+    measureDispatch<detail::HashMapRegistry>(report, "process/hash_map_registry");
+    measureDispatch<detail::UnsyncedHashMapRegistry>(report, "process/unsynced_hash_map_registry");
+    measureDispatch<detail::PagedRegistry>(report, "process/paged_registry");
+    measureRoundTrip(report);
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "Benchmark.h"
+
+#include "platform/ReactorPool.h"
+
+#include <algorithm>
+#include <future>
+#include <map>
+#include <string>
+
+#include <signal.h>
+#include <sys/socket.h>
+
+using namespace rpc;
+
+/**
+ * Throughput of many connections served by a ReactorPool, for increasing numbers of reactors.
+ *
+ * Each connection is a socketpair, the server ends are distributed over the
+ * pool under test, the client ends over a second pool of the same size. Every
+ * client keeps a fixed number of echo calls in flight, issuing a new one when a
+ * reply arrives. The number of completed calls is counted for a fixed period
+ * after a warm-up, the reported time per operation is the wall clock time
+ * divided by the number of calls completed by all the connections.
+ */
+
+using Ep = StlEndpoint<EpollStreamAdapter, detail::UnsyncedHashMapRegistry>;
+
+static constexpr auto echoSymbol = symbol<uint32_t, Call<uint32_t>>("echo"_ctstr);
+
+static constexpr size_t connections = 64;
+static constexpr size_t callsInFlight = 8;
+
+/**
+ * State of a client connection, on its own cache line.
+ */
+struct alignas(64) Client
+{
+    std::atomic<uint64_t> completed = {0};
+    decltype(echoSymbol)::CallType echo;
+    Call<uint32_t> reply;
+};
+
+/**
+ * Endpoints owned by the shards of a pool.
+ *
+ * Each shard only accesses its own list, the map itself is not modified after
+ * construction. The endpoints are destroyed on their own shard.
+ */
+class Endpoints
+{
+    std::map<EpollReactor*, std::vector<std::unique_ptr<Ep>>> owned;
+    ReactorPool& pool;
+
+public:
+    inline Endpoints(ReactorPool& pool): pool(pool)
+    {
+        for(size_t i = 0; i < pool.size(); i++)
+        {
+            owned[&pool.shard(i)];
+        }
+    }
+
+    /**
+     * Create an endpoint for the descriptor, must be called on the thread of the shard.
+     */
+    inline Ep& create(EpollReactor& r, int fd)
+    {
+        auto& list = owned[&r];
+        list.emplace_back(new Ep(r, fd));
+
+        auto& ep = *list.back();
+        r.attach(ep, []{});
+        return ep;
+    }
+
+    inline void destroy()
+    {
+        for(size_t i = 0; i < pool.size(); i++)
+        {
+            std::promise<void> done;
+            auto& list = owned[&pool.shard(i)];
+            pool.post(i, [&list, &done]{ list.clear(); done.set_value(); });
+            done.get_future().wait();
+        }
+    }
+};
+
+static double measure(size_t nReactors, std::chrono::milliseconds duration, uint64_t &completed)
+{
+    ReactorPool servers(nReactors), clients(nReactors, false);
+    Endpoints serverEndpoints(servers), clientEndpoints(clients);
+
+    std::vector<Client> state(connections);
+    std::atomic<bool> running = {true};
+
+    for(size_t i = 0; i < connections; i++)
+    {
+        int sv[2];
+
+        if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv))
+        {
+            return 0;
+        }
+
+        servers.distribute(sv[1], [&serverEndpoints](EpollReactor& r, int fd)
+        {
+            serverEndpoints.create(r, fd).provide(echoSymbol, [](Ep& ep, MethodHandle, uint32_t x, Call<uint32_t> reply)
+            {
+                ep.call(reply, x);
+            });
+        });
+
+        clients.distribute(sv[0], [&clientEndpoints, &running, &client = state[i]](EpollReactor& r, int fd)
+        {
+            clientEndpoints.create(r, fd).lookup(echoSymbol, [&running, &client](Ep& ep, bool ok, decltype(echoSymbol)::CallType echo)
+            {
+                if(!ok)
+                    return;
+
+                client.echo = echo;
+                client.reply = ep.install([&running, &client](Ep& ep, MethodHandle, uint32_t x)
+                {
+                    client.completed.fetch_add(1, std::memory_order_relaxed);
+
+                    if(running.load(std::memory_order_relaxed))
+                        ep.call(client.echo, x + 1, client.reply);
+                });
+
+                for(uint32_t k = 0; k < callsInFlight; k++)
+                    ep.call(client.echo, k, client.reply);
+            });
+        });
+    }
+
+    auto total = [&state]
+    {
+        uint64_t ret = 0;
+
+        for(const auto& c: state)
+            ret += c.completed.load(std::memory_order_relaxed);
+
+        return ret;
+    };
+
+    std::this_thread::sleep_for(duration / 4);
+
+    const auto before = total();
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(duration);
+    const auto after = total();
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    running = false;
+    clientEndpoints.destroy();
+    serverEndpoints.destroy();
+
+    completed = after - before;
+    return completed ? elapsed / double(completed) : 0;
+}
+
+int main()
+{
+    /*
+     * The connections are torn down while replies may still be in flight.
+     */
+    signal(SIGPIPE, SIG_IGN);
+
+    BenchmarkReport report;
+
+    const size_t maxReactors = std::max<size_t>(2, std::thread::hardware_concurrency());
+
+    for(size_t n = 1; n <= maxReactors; n *= 2)
+    {
+        uint64_t completed;
+        const auto nsPerOp = measure(n, std::chrono::milliseconds(1000), completed);
+        report.add(("reactor_pool/echo/reactors=" + std::to_string(n)).c_str(), completed, nsPerOp);
+    }
+
+    return 0;
+}
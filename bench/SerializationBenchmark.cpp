@@ -0,0 +1,92 @@
+#include "Benchmark.h"
+
+#include "platform/FdStreamAdapter.h"
+
+#include "types/PrimitiveTypeInfo.h"
+#include "types/StructTypeInfo.h"
+#include "types/StdStringTypeInfo.h"
+#include "types/StdVectorTypeInfo.h"
+#include "types/StdMapTypeInfo.h"
+#include "types/StdPairTypeInfo.h"
+#include "types/StdTupleTypeInfo.h"
+
+#include <string>
+
+using namespace rpc;
+
+/**
+ * Benchmarks of determineSize, serialize and the reading of the serialized
+ * values for the different families of TypeInfo implementations.
+ *
+ * Messages are built the same way as the endpoint does for a call, the buffers
+ * are taken from a pool, so that the heap allocator is out of the picture.
+ */
+
+struct Record
+{
+    int id;
+    std::string name;
+    uint64_t timestamp;
+};
+
+namespace rpc {
+
+template<> struct TypeInfo<Record>: StructTypeInfo<Record,
+    StructMember<&Record::id>,
+    StructMember<&Record::name>,
+    StructMember<&Record::timestamp>
+> {};
+
+}
+
+template<class T>
+static void measure(BenchmarkReport& report, const char* family, size_t iterations, const T& v)
+{
+    BufferPool pool;
+    PreallocatedMemoryBufferStreamWriterFactory f{&pool};
+
+    report.run(("determineSize/" + std::string(family)).c_str(), iterations, [&](size_t)
+    {
+        auto size = determineSize(v);
+        doNotOptimize(size);
+    });
+
+    report.run(("serialize/" + std::string(family)).c_str(), iterations, [&](size_t)
+    {
+        auto w = f.build(determineSize(v));
+        serialize(w, v);
+        auto m = f.done(std::move(w));
+        doNotOptimize(m);
+    });
+
+    auto w = f.build(determineSize(v));
+    serialize(w, v);
+    auto m = f.done(std::move(w));
+
+    report.run(("read/" + std::string(family)).c_str(), iterations, [&](size_t)
+    {
+        auto a = m.access();
+        T out;
+        TypeInfo<T>::read(a, out);
+        doNotOptimize(out);
+    });
+}
+
+int main()
+{
+    BenchmarkReport report;
+
+    measure(report, "primitive", 5000000, uint64_t(0x123456789abcdef));
+    measure(report, "string", 2000000, std::string(64, 'x'));
+    measure(report, "vector", 200000, std::vector<int>(1000, 7));
+
+    std::map<int, std::string> map;
+    for(int i = 0; i < 64; i++)
+        map[i] = "value" + std::to_string(i);
+
+    measure(report, "map", 50000, map);
+    measure(report, "struct", 2000000, Record{1, "name", 1234567890123});
+    measure(report, "tuple", 2000000, std::tuple<int, std::string, bool>{1, "tuple", true});
+
+    return 0;
+}
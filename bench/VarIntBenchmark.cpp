@@ -0,0 +1,218 @@
+#include "Benchmark.h"
+
+#include "platform/FdStreamAdapter.h"
+
+#include <random>
+#include <vector>
+
+using namespace rpc;
+
+/**
+ * Benchmarks of the variable length integer coding.
+ *
+ * The fast paths are compared against the generic byte-by-byte loops, which
+ * are used for accessors that do not expose the underlying memory. Those are
+ * measured using the bytewise accessors below, on the same data. The length
+ * computation is compared against a chain of comparisons.
+ */
+
+/**
+ * Input accessor that only supports reading bytes one at a time.
+ */
+struct BytewiseReader
+{
+    const char *ptr, *end;
+
+    template<class T>
+    inline bool read(T& v)
+    {
+        if(size_t(end - ptr) < sizeof(T))
+            return false;
+
+        memcpy(&v, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return true;
+    }
+
+    inline bool skip(size_t n)
+    {
+        if(size_t(end - ptr) < n)
+            return false;
+
+        ptr += n;
+        return true;
+    }
+};
+
+/**
+ * Output accessor that only supports writing bytes one at a time.
+ */
+struct BytewiseWriter
+{
+    char *ptr, *end;
+
+    template<class T>
+    inline bool write(const T& v)
+    {
+        if(size_t(end - ptr) < sizeof(T))
+            return false;
+
+        memcpy(ptr, &v, sizeof(T));
+        ptr += sizeof(T);
+        return true;
+    }
+};
+
+/**
+ * Encoded length computed by comparisons, for reference.
+ */
+static inline size_t comparisonSize(uint32_t c)
+{
+    if(c < 128u)
+        return 1;
+    else if(c < 128u * 128)
+        return 2;
+    else if(c < 128u * 128 * 128)
+        return 3;
+    else if(c < 128u * 128 * 128 * 128)
+        return 4;
+
+    return 5;
+}
+
+/**
+ * Values of mixed encoded length, with the shorter ones being more frequent (like in actual messages).
+ */
+static std::vector<uint32_t> sampleValues(size_t n)
+{
+    std::mt19937 rng(1);
+    std::vector<uint32_t> ret(n);
+
+    for(auto &v: ret)
+    {
+        const auto bits = rng() % 22;
+        v = rng() & ((1u << bits) - 1);
+    }
+
+    return ret;
+}
+
+int main()
+{
+    BenchmarkReport report;
+
+    static constexpr size_t count = 64 * 1024;
+    const auto values = sampleValues(count);
+
+    /*
+     * At most five bytes per value, with padding for the word sized loads.
+     */
+    std::vector<char> encoded(count * 5 + sizeof(uint64_t));
+    PreallocatedMemoryBufferStream::Accessor w(encoded.data(), encoded.data() + encoded.size());
+
+    for(auto v: values)
+    {
+        VarUint4::write(w, v);
+    }
+
+    const auto encodedEnd = w.ptr;
+
+    report.run("varuint4/size/comparison", 200, [&](size_t)
+    {
+        size_t total = 0;
+
+        for(auto v: values)
+        {
+            total += comparisonSize(v);
+        }
+
+        doNotOptimize(total);
+    }, count);
+
+    report.run("varuint4/size/clz", 200, [&](size_t)
+    {
+        size_t total = 0;
+
+        for(auto v: values)
+        {
+            total += VarUint4::size(v);
+        }
+
+        doNotOptimize(total);
+    }, count);
+
+    std::vector<char> out(encoded.size());
+
+    report.run("varuint4/write/bytewise", 200, [&](size_t)
+    {
+        BytewiseWriter w{out.data(), out.data() + out.size()};
+
+        for(auto v: values)
+        {
+            VarUint4::write(w, v);
+        }
+
+        doNotOptimize(out[0]);
+    }, count);
+
+    report.run("varuint4/write/contiguous", 200, [&](size_t)
+    {
+        PreallocatedMemoryBufferStream::Accessor w(out.data(), out.data() + out.size());
+
+        for(auto v: values)
+        {
+            VarUint4::write(w, v);
+        }
+
+        doNotOptimize(out[0]);
+    }, count);
+
+    report.run("varuint4/read/bytewise", 200, [&](size_t)
+    {
+        BytewiseReader r{encoded.data(), encodedEnd};
+        uint32_t sum = 0, v;
+
+        for(size_t i = 0; i < count; i++)
+        {
+            VarUint4::read(r, v);
+            sum += v;
+        }
+
+        doNotOptimize(sum);
+    }, count);
+
+    report.run("varuint4/read/contiguous", 200, [&](size_t)
+    {
+        PreallocatedMemoryBufferStream::Accessor r(encoded.data(), encodedEnd);
+        uint32_t sum = 0, v;
+
+        for(size_t i = 0; i < count; i++)
+        {
+            VarUint4::read(r, v);
+            sum += v;
+        }
+
+        doNotOptimize(sum);
+    }, count);
+
+    report.run("varuint4/skip/bytewise", 200, [&](size_t)
+    {
+        BytewiseReader r{encoded.data(), encodedEnd};
+
+        for(size_t i = 0; i < count; i++)
+        {
+            VarUint4::skip(r);
+        }
+
+        doNotOptimize(r.ptr);
+    }, count);
+
+    report.run("varuint4/skip/contiguous", 200, [&](size_t)
+    {
+        PreallocatedMemoryBufferStream::Accessor r(encoded.data(), encodedEnd);
+        VarUint4::skip(r, count);
+        doNotOptimize(r.ptr);
+    }, count);
+
+    return 0;
+}
@@ -6,11 +6,17 @@
 
 #include "types/CallTypeInfo.h"
 #include "types/PrimitiveTypeInfo.h"
+#include "types/CompactTypeInfo.h"
+
+#include "support/StreamReader.h"
+#include "support/CollectionGenerator.h"
 
 #include "Symbol.h"
 #include "Serdes.h"
 #include "SignatureGenerator.h"
 
+#include <atomic>
+
 namespace rpc {
 
 struct EmptyBase {};
@@ -88,6 +94,12 @@ class Endpoint
 		 */
 		inline Invoker(T&& target): target(rpc::move(target)) {}
 
+		/**
+		 * Move constructor for pointer policies that store the invoker
+		 * inline and need to relocate it when the pointer is moved.
+		 */
+		inline Invoker(Invoker&&) = default;
+
 		/**
 		 * The virtual destructor is required because the captured
 		 * functor may have non-trivial destructor. (for example
@@ -114,9 +126,83 @@ class Endpoint
 	Registry<decltype(""_ctstr.hash()), CallId> symbolRegistry;
 
 	/**
-	 * Helper to assign the next free id to a new registration.
+	 * Identifiers are made up of a slot index and a generation tag in the low bits.
+	 *
+	 * Indices are handed out cyclically from a window that is kept at least twice
+	 * as large as the number of live registrations, the generation tag is the
+	 * number of completed cycles. This way freed identifiers are only reused after
+	 * the allocator went around the window 2^genBits times, while the identifiers
+	 * stay small (and short on the wire) regardless of the number of registrations
+	 * made during the lifetime of the endpoint.
+	 *
+	 * Note that this is only a weak guard against stale identifiers: with the
+	 * minimal window of 32 slots a freed identifier can come back after as few
+	 * as 4 * 31 = 124 further registrations. It catches late replies arriving
+	 * shortly after a release, but the application must not rely on identifiers
+	 * being unique over a longer time span.
+	 */
+	static constexpr CallId genBits = 2, genMask = (1u << genBits) - 1;
+	static constexpr CallId minWindow = 128u >> genBits, maxWindow = 1u << (31 - genBits);
+
+	/**
+	 * Helpers to assign the next free id to a new registration.
+	 *
+	 * Registrations are made by the calling threads while releases are done by
+	 * the receiving one, so the allocator state is kept in atomics: the cursor
+	 * and the lap counter are packed into a single word that is advanced with
+	 * compare-and-swap, the number of live registrations is a plain counter.
 	 */
-	CallId maxId = 0;
+	std::atomic<uint64_t> position = {1};
+	std::atomic<CallId> nLive = {0};
+
+	inline CallId nextId()
+	{
+		const CallId live = nLive.load(std::memory_order_relaxed);
+		CallId window = minWindow;
+
+		while(window < 2 * (live + 1) && window < maxWindow)
+		{
+			window *= 2;
+		}
+
+		uint64_t current = position.load(std::memory_order_relaxed), next;
+		CallId cursor, lap;
+
+		do
+		{
+			cursor = CallId(current);
+			lap = CallId(current >> 32);
+
+			if(cursor >= window)
+			{
+				cursor = 1;
+				lap++;
+			}
+
+			next = (uint64_t(lap) << 32) | (cursor + 1);
+		}
+		while(!position.compare_exchange_weak(current, next, std::memory_order_relaxed));
+
+		return (cursor << genBits) | (lap & genMask);
+	}
+
+	/**
+	 * Remove a registration made with add.
+	 */
+	inline bool release(CallId id)
+	{
+		if(!registry.remove(id))
+		{
+			return false;
+		}
+
+		if(id != lookupId)
+		{
+			nLive.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		return true;
+	}
 
 	/**
 	 * Process an incoming message.
@@ -157,17 +243,34 @@ class Endpoint
 
 		do
 		{
-			id = maxId++;
+			id = nextId();
 		}
 		while(!registry.add(id, rpc::move(ptr)));
 
+		nLive.fetch_add(1, std::memory_order_relaxed);
 		return id;
 	}
 
+	/**
+	 * Checks if a message factory can build messages without knowing their size in advance.
+	 */
+	template<class Factory> static constexpr inline auto canBuildUnsized(Factory* f) -> decltype(f->build(), true) { return true; }
+	static constexpr inline bool canBuildUnsized(...) { return false; }
+
+	/**
+	 * Maximal payload length of the messages that a factory can build in inline storage, zero if none.
+	 */
+	template<class Factory> static constexpr inline auto inlineCapacityOf(Factory* f) -> decltype(f->buildInline(), size_t()) { return Factory::inlineCapacity; }
+	static constexpr inline size_t inlineCapacityOf(...) { return 0; }
+
 	/**
 	 * Build a message for invoking a method with the provided identifier
 	 * and arguments. Arguments are serialized using the serialize helper
 	 * according to the rules specified by the TypeInfo template class.
+	 *
+	 * Messages that are known in compile time to fit are written into inline
+	 * storage, otherwise the size of the message is determined beforehand only
+	 * if the factory needs it.
 	 */
 	template<class... NominalArgs, class... ActualArgs, class Factory>
 	static inline auto buildCall(Factory& factory, bool &ok, CallId id, ActualArgs&&... args)
@@ -177,13 +280,62 @@ class Endpoint
 
 		static_assert(writeSignature<NominalArgs...>(""_ctstr) == writeSignature<ActualArgs...>(""_ctstr), "RPC invocation signature mismatched");
 
-		auto size = determineSize(c, args...);
-		auto pdu = factory.build(size);
+		if constexpr(maxSerializedSize<C, ActualArgs...>() <= inlineCapacityOf((Factory*)nullptr))
+		{
+			auto pdu = factory.buildInline();
 
-		ok = serialize(pdu, c, rpc::forward<ActualArgs>(args)...);
-		return factory.done(rpc::move(pdu));
+			ok = serialize(pdu, c, rpc::forward<ActualArgs>(args)...);
+			return factory.done(rpc::move(pdu));
+		}
+		else if constexpr(canBuildUnsized((Factory*)nullptr))
+		{
+			auto pdu = factory.build();
+
+			ok = serialize(pdu, c, rpc::forward<ActualArgs>(args)...);
+			return factory.done(rpc::move(pdu));
+		}
+		else
+		{
+			auto size = determineSize(c, args...);
+			auto pdu = factory.build(size);
+
+			ok = serialize(pdu, c, rpc::forward<ActualArgs>(args)...);
+			return factory.done(rpc::move(pdu));
+		}
+	}
+
+	/**
+	 * Hash of the set of exported symbols and their identifiers, maintained incrementally.
+	 *
+	 * It is updated by the threads that provide or discard symbols and read by the
+	 * receiving one when answering a query.
+	 */
+	std::atomic<uint32_t> contractFingerprint = {0};
+
+	/**
+	 * Mix a symbol hash and its identifier into a fingerprint component.
+	 *
+	 * The components are combined by XOR so that the result does not depend on the
+	 * order of registration and can be updated when a symbol is discarded.
+	 */
+	static constexpr inline uint32_t fingerprintOf(uint64_t idHash, CallId id)
+	{
+		auto x = idHash ^ (uint64_t(id) * 0x9e3779b97f4a7c15ull);
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+		x ^= x >> 33;
+		return uint32_t(x);
 	}
 
+	/**
+	 * The identifier of the batch lookup method of the remote end, if it is already known.
+	 *
+	 * It is resolved on the receiving thread and used by the calling ones, the identifier
+	 * is published by the release store of the flag that is read with acquire semantics.
+	 */
+	std::atomic<bool> batchLookupResolved = {false};
+	std::atomic<CallId> batchLookupId = {invalidId};
+
 	Errors doLookup(uint64_t id, size_t length, CallId cb)
 	{
 		bool buildOk;
@@ -233,6 +385,15 @@ public:
 			{
 				r = *result;
 			}
+			else if(idHash == fingerprintQueryHash)
+			{
+				/*
+				 * The reply is sent in place of an identifier, for which invalidId means that
+				 * the query is not supported, so that value of the fingerprint is folded onto zero.
+				 */
+				const auto fingerprint = ep.contractFingerprint.load(std::memory_order_relaxed);
+				r = fingerprint != invalidId ? fingerprint : 0;
+			}
 			else
 			{
 				ret = Errors::unknownSymbolRequested;
@@ -248,7 +409,35 @@ public:
 
 		auto respInvoker = Pointer<IInvoker>::template make<Invoker<Endpoint&, decltype(lookupResponder), uint64_t, Call<CallId>>>(rpc::move(lookupResponder));
 
-		return registry.add(lookupId, rpc::move(respInvoker));
+		if(!registry.add(lookupId, rpc::move(respInvoker)))
+		{
+			return false;
+		}
+
+		auto batchLookupResponder = [](Endpoint& ep, const MethodHandle &id, StreamReader<uint64_t, InputAccessor> hashes, Call<CollectionPlaceholder<CallId>> callback)
+		{
+			auto results = generateCollection(hashes.size(), [&ep, it{hashes.begin()}](uint32_t) mutable
+			{
+				uint64_t idHash;
+
+				if(it.read(idHash))
+				{
+					bool ok;
+					auto result = ep.symbolRegistry.find(idHash, ok);
+
+					if(ok)
+					{
+						return *result;
+					}
+				}
+
+				return invalidId;
+			});
+
+			return ep.call(callback, results);
+		};
+
+		return provide(batchLookupSymbol, rpc::move(batchLookupResponder)) == Errors::success;
 	}
 
 	/**
@@ -310,7 +499,7 @@ public:
 	 */
 	inline Errors uninstall(const rpc::MethodHandle &h)
 	{
-		if(!registry.remove(h.id))
+		if(!release(h.id))
 		{
 			return Errors::methodNotFound;
 		}
@@ -374,9 +563,11 @@ public:
 	{
 		Call<Args...> id = this->install(rpc::forward<C>(c));
 		
+		const auto callId = id.id;
+
 		if(!symbolRegistry.add(sym.hash(), rpc::move(id.id)))
 		{
-			if(!registry.remove(id.id))
+			if(!release(id.id))
 			{
 				return Errors::internalError; // GCOV_EXCL_LINE
 			}
@@ -384,6 +575,7 @@ public:
 			return Errors::symbolAlreadyExported;
 		}
 
+		contractFingerprint.fetch_xor(fingerprintOf(sym.hash(), callId), std::memory_order_relaxed);
 		return Errors::success;
 	}
 
@@ -411,11 +603,13 @@ public:
 
 		auto result = *rPtr;
 
-		if(!symbolRegistry.remove(idHash) || !registry.remove(result))
+		if(!symbolRegistry.remove(idHash) || !release(result))
 		{
 			return Errors::internalError; // GCOV_EXCL_LINE
 		}
-		
+
+		contractFingerprint.fetch_xor(fingerprintOf(idHash, result), std::memory_order_relaxed);
+
 		return Errors::success;
 	}
 
@@ -441,22 +635,59 @@ public:
 	inline Errors lookup(const Symbol<n, Args...> &sym, C&& c)
 	{
 		using Ep = typename CallOperatorFirstArgTypeExtractor<decltype(&C::operator())>::T;
+		return doSingleLookup<Ep, false>(sym, rpc::forward<C>(c));
+	}
 
-		auto id = add<Ep, CallId>([this, c{rpc::forward<C>(c)}](Ep &ep, const rpc::MethodHandle &handle, CallId result) mutable
+private:
+	/**
+	 * Pass a locally made up result to a registered lookup result handler.
+	 *
+	 * Used when the request could not be sent for a lookup that is issued from a result
+	 * handler of another one (i.e. a step of a lookupAll). In that case the functor of
+	 * the user is already moved into the new handler, so the failure can only be reported
+	 * through it. The handler releases its registration as usual.
+	 */
+	template<class Ep, class H, class Arg>
+	inline void failLocally(CallId id, Arg&& result)
+	{
+		bool ok;
+		auto it = registry.find(id, ok);
+
+		if(ok)
+		{
+			auto invoker = static_cast<Invoker<Ep, H, remove_cref_t<Arg>>*>(&**it);
+			invoker->target(static_cast<Ep&>(*this), MethodHandle(id), rpc::forward<Arg>(result));
+		}
+	}
+
+	/**
+	 * Implementation of lookup, if notifyHandler is set a failure to send the request is
+	 * reported to the functor (see failLocally) besides the returned error code.
+	 */
+	template<class Ep, bool notifyHandler, size_t n, class... Args, class C>
+	inline Errors doSingleLookup(const Symbol<n, Args...> &sym, C&& c)
+	{
+		auto handler = [this, c{rpc::forward<C>(c)}](Ep &ep, const rpc::MethodHandle &handle, CallId result) mutable
 		{
 			c(ep, result != invalidId, Call<Args...>{result});
 
-			if(!registry.remove(handle.id))
+			if(!release(handle.id))
 			{
 				return Errors::internalError; // GCOV_EXCL_LINE
 			}
 
 			return Errors::success;
-		});
+		};
+
+		auto id = add<Ep, CallId>(rpc::move(handler));
 
 		if(auto err = doLookup(sym.hash(), n, id); !!err)
 		{
-			if(!registry.remove(id))
+			if constexpr(notifyHandler)
+			{
+				failLocally<Ep, decltype(handler)>(id, invalidId);
+			}
+			else if(!release(id))
 			{
 				return Errors::internalError; // GCOV_EXCL_LINE
 			}
@@ -467,6 +698,260 @@ public:
 		return Errors::success;
 	}
 
+	/**
+	 * Sends a batch lookup request for the symbols, the remote identifiers are passed to the
+	 * functor as Call objects in the same order as the symbols were specified.
+	 */
+	template<class Ep, bool notifyHandler, class C, class... Syms, size_t... idx>
+	inline Errors doBatchLookup(const sequence<idx...>&, CallId batchId, C&& c, const Syms&... syms)
+	{
+		constexpr auto n = sizeof...(Syms);
+
+		auto handler = [this, c{rpc::forward<C>(c)}](Ep &ep, const rpc::MethodHandle &handle, StreamReader<CallId, InputAccessor> ids) mutable
+		{
+			CallId results[n];
+			bool ok = ids.size() == n;
+
+			auto it = ids.begin();
+
+			for(auto &r: results)
+			{
+				if(!it.read(r))
+				{
+					r = invalidId;
+				}
+
+				ok = ok && r != invalidId;
+			}
+
+			c(ep, ok, typename Syms::CallType{results[idx]}...);
+
+			if(!release(handle.id))
+			{
+				return Errors::internalError; // GCOV_EXCL_LINE
+			}
+
+			return Errors::success;
+		};
+
+		auto id = add<Ep, StreamReader<CallId, InputAccessor>>(rpc::move(handler));
+
+		const uint64_t hashes[n] = {syms.hash()...};
+		auto request = generateCollection(n, [&hashes](uint32_t remaining){ return hashes[n - 1 - remaining]; });
+
+		bool buildOk;
+		auto f = static_cast<IoEngine*>(this)->messageFactory();
+		auto data = buildCall<CollectionPlaceholder<uint64_t>, Call<CollectionPlaceholder<CallId>>>(f, buildOk, batchId, request, Call<CollectionPlaceholder<CallId>>{id});
+
+		Errors err = Errors::success;
+
+		if(!buildOk)
+		{
+			err = Errors::couldNotCreateLookupMessage;
+		}
+		else if(!static_cast<IoEngine*>(this)->send(rpc::move(data)))
+		{
+			err = Errors::couldNotSendLookupMessage;
+		}
+
+		if(!!err)
+		{
+			if constexpr(notifyHandler)
+			{
+				failLocally<Ep, decltype(handler)>(id, StreamReader<CallId, InputAccessor>{});
+			}
+			else if(!release(id))
+			{
+				return Errors::internalError; // GCOV_EXCL_LINE
+			}
+		}
+
+		return err;
+	}
+
+	/**
+	 * Pass the Call objects made from an array of identifiers to a lookup result handler.
+	 */
+	template<class... Syms, class Ep, class C, size_t... idx>
+	static inline void callWithIds(const sequence<idx...>&, Ep &ep, C &c, const CallId* ids) {
+		c(ep, true, typename Syms::CallType{ids[idx]}...);
+	}
+
+	/**
+	 * Fallback for peers without batch lookup: looks up the symbols one after the other.
+	 */
+	template<class Ep, bool notifyHandler, class C, size_t n, class... Args, class... Rest>
+	inline Errors lookupEach(C&& c, const Symbol<n, Args...> &sym, const Rest&... rest)
+	{
+		return doSingleLookup<Ep, notifyHandler>(sym, [c{rpc::forward<C>(c)}, rest...](Ep &ep, bool ok, Call<Args...> result) mutable
+		{
+			if constexpr(sizeof...(Rest) == 0)
+			{
+				c(ep, ok, result);
+			}
+			else
+			{
+				ep.template lookupEach<Ep, true>([c{rpc::move(c)}, ok, result](Ep &ep, bool restOk, auto... restResults) mutable {
+					c(ep, ok && restOk, result, restResults...);
+				}, rest...);
+			}
+		});
+	}
+
+	/**
+	 * Implementation of lookupAll, see doSingleLookup for the meaning of notifyHandler.
+	 */
+	template<class Ep, bool notifyHandler, class C, class... Syms>
+	inline Errors doLookupAll(C&& c, const Syms&... syms)
+	{
+		if(batchLookupResolved.load(std::memory_order_acquire))
+		{
+			if(const auto id = batchLookupId.load(std::memory_order_relaxed); id != invalidId)
+			{
+				return doBatchLookup<Ep, notifyHandler>(indices<sizeof...(Syms)>{}, id, rpc::forward<C>(c), syms...);
+			}
+
+			return lookupEach<Ep, notifyHandler>(rpc::forward<C>(c), syms...);
+		}
+
+		return doSingleLookup<Ep, notifyHandler>(batchLookupSymbol, [c{rpc::forward<C>(c)}, syms...](Ep &ep, bool ok, decltype(batchLookupSymbol)::CallType batch) mutable
+		{
+			ep.batchLookupId.store(ok ? batch.id : invalidId, std::memory_order_relaxed);
+			ep.batchLookupResolved.store(true, std::memory_order_release);
+			ep.template doLookupAll<Ep, true>(rpc::move(c), syms...);
+		});
+	}
+
+public:
+	/**
+	 * Symbol of the batch lookup method that is provided by every endpoint.
+	 */
+	static constexpr auto batchLookupSymbol = symbol<CollectionPlaceholder<uint64_t>, Call<CollectionPlaceholder<CallId>>>("lookupBatch"_ctstr);
+
+	/**
+	 * Reserved symbol hash used to query the contract fingerprint via the lookup method.
+	 *
+	 * The name has no signature part, so it can not collide with any real symbol,
+	 * remote ends that do not know about it simply reply with an invalid identifier.
+	 */
+	static constexpr uint64_t fingerprintQueryHash = "contractFingerprint"_ctstr.hash();
+
+	/**
+	 * Lookup several public remote methods in a single exchange.
+	 *
+	 * Works like lookup, but the functor receives the results for all the symbols:
+	 *
+	 *   - first: a reference to the Endpoint object,
+	 *   - second: a bool value, which is true if all of the symbols were found,
+	 *   - the rest: Call objects for each of the symbols, in the order they were specified.
+	 *
+	 * The batch lookup method of the remote end is looked up on the first use, if the
+	 * remote end does not provide it (i.e. it is an older version) the symbols are looked
+	 * up one by one instead.
+	 *
+	 * The returned error code indicates success or the type of failure that occurred.
+	 */
+	template<class C, class... Syms>
+	inline Errors lookupAll(C&& c, const Syms&... syms)
+	{
+		using Ep = typename CallOperatorFirstArgTypeExtractor<decltype(&C::operator())>::T;
+
+		static_assert(sizeof...(Syms) > 0, "at least one symbol must be specified");
+
+		return doLookupAll<Ep, false>(rpc::forward<C>(c), syms...);
+	}
+
+	/**
+	 * Query the contract fingerprint of the remote end.
+	 *
+	 * The fingerprint is a 32-bit hash over the symbols exported by the remote end and
+	 * their identifiers, if it matches a previously seen one then the identifiers
+	 * resolved back then are still valid. The functor receives:
+	 *
+	 *   - first: a reference to the Endpoint object,
+	 *   - second: a bool value, which is false if the remote end does not support the query,
+	 *   - third: the fingerprint, valid only if the second argument is true.
+	 *
+	 * The returned error code indicates success or the type of failure that occurred.
+	 */
+	template<class C>
+	inline Errors queryFingerprint(C&& c)
+	{
+		using Ep = typename CallOperatorFirstArgTypeExtractor<decltype(&C::operator())>::T;
+
+		auto id = add<Ep, CallId>([this, c{rpc::forward<C>(c)}](Ep &ep, const rpc::MethodHandle &handle, CallId result) mutable
+		{
+			c(ep, result != invalidId, uint32_t(result));
+
+			if(!release(handle.id))
+			{
+				return Errors::internalError; // GCOV_EXCL_LINE
+			}
+
+			return Errors::success;
+		});
+
+		if(auto err = doLookup(fingerprintQueryHash, 0, id); !!err)
+		{
+			if(!release(id))
+			{
+				return Errors::internalError; // GCOV_EXCL_LINE
+			}
+
+			return err;
+		}
+
+		return Errors::success;
+	}
+
+	/**
+	 * Lookup several public remote methods using a cache of previous results.
+	 *
+	 * Works like lookupAll, but first the contract fingerprint of the remote end is
+	 * queried, if the identifiers of all the symbols are found in the cache for that
+	 * fingerprint, no further lookup is needed. Otherwise the symbols are looked up
+	 * and the results are stored in the cache.
+	 *
+	 * The cache object must provide the following methods (see SymbolCache):
+	 *
+	 *   - bool get(uint32_t fingerprint, uint64_t symbolHash, uint32_t &id),
+	 *   - void put(uint32_t fingerprint, uint64_t symbolHash, uint32_t id).
+	 *
+	 * NOTE: the cache must outlive the operation.
+	 *
+	 * The returned error code indicates success or the type of failure that occurred.
+	 */
+	template<class Cache, class C, class... Syms>
+	inline Errors lookupAllCached(Cache &cache, C&& c, const Syms&... syms)
+	{
+		using Ep = typename CallOperatorFirstArgTypeExtractor<decltype(&C::operator())>::T;
+
+		return queryFingerprint([&cache, c{rpc::forward<C>(c)}, syms...](Ep &ep, bool ok, uint32_t fingerprint) mutable
+		{
+			if(ok)
+			{
+				CallId ids[sizeof...(Syms)];
+				size_t idx = 0;
+
+				if(((cache.get(fingerprint, syms.hash(), ids[idx++])) && ...))
+				{
+					callWithIds<Syms...>(indices<sizeof...(Syms)>{}, ep, c, ids);
+					return;
+				}
+			}
+
+			ep.template doLookupAll<Ep, true>([&cache, c{rpc::move(c)}, ok, fingerprint, syms...](Ep &ep, bool found, typename Syms::CallType... results) mutable
+			{
+				if(ok && found)
+				{
+					(cache.put(fingerprint, syms.hash(), results.id), ...);
+				}
+
+				c(ep, found, results...);
+			}, syms...);
+		});
+	}
+
 	/**
 	 * Issues a simulated call to a locally registered method that takes no arguments.
 	 */
@@ -22,8 +22,8 @@ template<class...> struct SignatureGenerator;
  */
 template<> struct SignatureGenerator<>
 {
-	template<class S> static inline constexpr decltype(auto) writeTypes(S&& s) { return s; }
-	template<class S> static inline constexpr decltype(auto) writeNextType(S&& s) { return s; }
+	template<class S> static inline constexpr decltype(auto) writeTypes(S&& s) { return rpc::forward<S>(s); }
+	template<class S> static inline constexpr decltype(auto) writeNextType(S&& s) { return rpc::forward<S>(s); }
 };
 
 /**
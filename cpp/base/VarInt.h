@@ -3,9 +3,39 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define RPC_VARINT_SWAR 1
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#endif
 
 namespace rpc {
 
+namespace detail
+{
+	/*
+	 * Optional accessor capabilities used by the fast paths.
+	 */
+	template<class S> static constexpr inline auto hasContiguous(S* s) -> decltype(s->contiguous(*(size_t*)nullptr), true) { return true; }
+	static constexpr inline bool hasContiguous(...) { return false; }
+
+	template<class S> static constexpr inline auto canWriteBlock(S* s) -> decltype(s->writeBlock((const void*)nullptr, size_t(0))) { return true; }
+	static constexpr inline bool canWriteBlock(...) { return false; }
+
+	template<class S> static constexpr inline auto canReadBlock(S* s) -> decltype(s->readBlock((void*)nullptr, size_t(0))) { return true; }
+	static constexpr inline bool canReadBlock(...) { return false; }
+
+	template<class S> static constexpr inline auto canWriteReference(S* s) -> decltype(s->writeReference((const void*)nullptr, size_t(0))) { return true; }
+	static constexpr inline bool canWriteReference(...) { return false; }
+
+	template<class S> static constexpr inline auto canWritePrefix(S* s) -> decltype(s->writePrefix(uint64_t(0), size_t(0))) { return true; }
+	static constexpr inline bool canWritePrefix(...) { return false; }
+}
+
 /**
  * Variable length encoding for unsigned 32 bit values.
  * 
@@ -13,11 +43,23 @@ namespace rpc {
  */
 struct VarUint4
 {
+	/**
+	 * Length of the longest encoded byte sequence.
+	 */
+	static constexpr size_t maxLength = 5;
+
 	/**
 	 * Determine the corresponding encoded byte sequence length for a value.
 	 */
 	static constexpr inline size_t size(uint32_t c) 
 	{
+#if defined(__GNUC__)
+		/*
+		 * Number of significant bits divided by seven (rounded up), without division.
+		 */
+		const auto bits = size_t(32 - __builtin_clz(c | 1));
+		return (bits * 9 + 64) >> 6;
+#else
 		if(c < 128)
 			return 1;
 		else if(c < 128 * 128)
@@ -28,13 +70,40 @@ struct VarUint4
 			return 4;
 
 		return 5;
+#endif
+	}
+
+#if RPC_VARINT_SWAR
+	/**
+	 * Encode a value into the low bytes of a word, returns the length of the encoded value.
+	 */
+	static inline size_t encode(uint32_t v, uint64_t &out)
+	{
+		const uint64_t x = v;
+		const auto n = size(v);
+		const auto cont = 0x0000008080808080ull & ((1ull << (8 * (n - 1))) - 1);
+		out = (x & 0x7f) | ((x << 1) & (0x7full << 8)) | ((x << 2) & (0x7full << 16)) | ((x << 3) & (0x7full << 24)) | ((x << 4) & (0xfull << 32)) | cont;
+		return n;
 	}
+#endif
 
 	/**
 	 * Write 32 bit unsigned value to stream using variable length encoding.
+	 *
+	 * If the accessor supports it, the encoded value is assembled in a register
+	 * and stored at once, instead of writing it byte by byte.
 	 */
 	template<class S> static inline bool write(S& s, uint32_t v) 
 	{
+#if RPC_VARINT_SWAR
+		if constexpr(detail::canWritePrefix((S*)nullptr))
+		{
+			uint64_t x;
+			const auto n = encode(v, x);
+			return s.writePrefix(x, n);
+		}
+#endif
+
 		while(v >= 0x80)
 		{
 			if(!s.write(uint8_t(v | 0x80)))
@@ -46,11 +115,129 @@ struct VarUint4
 		return s.write(uint8_t(v));
 	}
 
+#if RPC_VARINT_SWAR
+	/**
+	 * Decode a single value from memory, with at least eight bytes available.
+	 *
+	 * The terminating byte is located with a single test on a word, instead of
+	 * checking the bytes one by one. Returns the length of the encoded value.
+	 */
+	static inline size_t decode(const char* p, uint32_t &v)
+	{
+		uint64_t x;
+		memcpy(&x, p, sizeof(x));
+
+		const auto stops = ~x & 0x8080808080808080ull;
+		auto n = stops ? (size_t(__builtin_ctzll(stops)) >> 3) + 1 : 8;
+
+		if(n > 5)
+		{
+			n = 5;
+		}
+
+		x &= ~0ull >> (64 - 8 * n);
+		v = uint32_t((x & 0x7f) | ((x >> 1) & (0x7full << 7)) | ((x >> 2) & (0x7full << 14)) | ((x >> 3) & (0x7full << 21)) | ((x >> 4) & (0xfull << 28)));
+		return n;
+	}
+
+	/**
+	 * Get the length of a sequence of encoded values in memory.
+	 *
+	 * The continuation bits of a block of bytes are collected into a bit mask (using
+	 * SSE2 if available), and the terminating bytes in it are counted all at once.
+	 * Blocks that are not well-formed (more than four continuation bytes in a row,
+	 * which the writer never produces) and the tail are handled one by one, in the
+	 * same way as skip does it. Returns zero if the data ends before the last value.
+	 */
+	static inline size_t measure(const char* p, size_t length, uint32_t count)
+	{
+		const auto start = p, end = p + length;
+		size_t carry = 0;
+
+#if defined(__SSE2__)
+		static constexpr size_t blockSize = 16;
+#else
+		static constexpr size_t blockSize = 8;
+#endif
+
+		while(count && size_t(end - p) >= blockSize)
+		{
+#if defined(__SSE2__)
+			const uint32_t cont = uint32_t(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+#else
+			uint64_t x;
+			memcpy(&x, p, sizeof(x));
+			const uint32_t cont = uint32_t(((x & 0x8080808080808080ull) * 0x0002040810204081ull) >> 56);
+#endif
+			const uint32_t stops = ~cont & ((1u << blockSize) - 1);
+
+			if(!stops || (cont & cont >> 1 & cont >> 2 & cont >> 3 & cont >> 4) || carry + __builtin_ctz(stops) > 4)
+				break;
+
+			const auto n = uint32_t(__builtin_popcount(stops));
+
+			if(n >= count)
+			{
+				auto t = stops;
+
+				while(--count)
+				{
+					t &= t - 1;
+				}
+
+				return size_t(p - start) + __builtin_ctz(t) + 1;
+			}
+
+			count -= n;
+			carry = blockSize - 1 - (31 - __builtin_clz(stops));
+			p += blockSize;
+		}
+
+		if(count)
+		{
+			p -= carry;
+
+			for(uint8_t nBytes = 0; p < end; p++)
+			{
+				if(++nBytes == 5 || !(*p & 0x80))
+				{
+					nBytes = 0;
+
+					if(!--count)
+					{
+						return size_t(p + 1 - start);
+					}
+				}
+			}
+
+			return 0;
+		}
+
+		return size_t(p - start);
+	}
+#endif
+
 	/**
 	 * Read 32 bit unsigned variable length coded value from stream.
+	 *
+	 * If the accessor provides direct access to the underlying memory, and there
+	 * is enough data left, the value is decoded without reading it byte by byte.
 	 */
 	template<class S> static inline bool read(S& s, uint32_t &v)
 	{
+#if RPC_VARINT_SWAR
+		if constexpr(detail::hasContiguous((S*)nullptr))
+		{
+			size_t length;
+			const auto p = s.contiguous(length);
+
+			if(length >= sizeof(uint64_t))
+			{
+				return s.skip(decode(p, v));
+			}
+		}
+#endif
+
 		uint8_t nBytes = 0;
 		v = 0;
 
@@ -97,6 +284,31 @@ struct VarUint4
 		return false;
 	}
 
+	/**
+	 * Skip a number of consecutive variable length encoded values in stream.
+	 */
+	template<class S> static inline bool skip(S& s, uint32_t count)
+	{
+#if RPC_VARINT_SWAR
+		if constexpr(detail::hasContiguous((S*)nullptr))
+		{
+			if(!count)
+				return true;
+
+			size_t length;
+			const auto p = s.contiguous(length);
+			const auto n = measure(p, length, count);
+			return n && s.skip(n);
+		}
+#endif
+
+		while(count--)
+			if(!skip(s))
+				return false;
+
+		return true;
+	}
+
 	/**
 	 * Streaming variable length decoder state machine.
 	 */
@@ -137,6 +349,183 @@ struct VarUint4
 	};
 };
 
+/**
+ * Variable length encoding for unsigned 64 bit values.
+ *
+ * Uses the same LEB128 encoding as VarUint4, extended to 1-10 bytes.
+ */
+struct VarUint8
+{
+	/**
+	 * Length of the longest encoded byte sequence.
+	 */
+	static constexpr size_t maxLength = 10;
+
+	/**
+	 * Determine the corresponding encoded byte sequence length for a value.
+	 */
+	static constexpr inline size_t size(uint64_t c)
+	{
+#if defined(__GNUC__)
+		const auto bits = size_t(64 - __builtin_clzll(c | 1));
+		return (bits * 9 + 64) >> 6;
+#else
+		size_t ret = 1;
+
+		while(c >= 0x80)
+		{
+			c >>= 7;
+			ret++;
+		}
+
+		return ret;
+#endif
+	}
+
+#if RPC_VARINT_SWAR
+	/**
+	 * Decode a value that fits in eight bytes from memory, with at least eight bytes available.
+	 *
+	 * Returns the length of the encoded value or zero if it is longer than eight bytes.
+	 */
+	static inline size_t decode(const char* p, uint64_t &v)
+	{
+		uint64_t x;
+		memcpy(&x, p, sizeof(x));
+
+		const auto stops = ~x & 0x8080808080808080ull;
+
+		if(!stops)
+			return 0;
+
+		const auto n = (size_t(__builtin_ctzll(stops)) >> 3) + 1;
+		x &= (~0ull >> (64 - 8 * n)) & 0x7f7f7f7f7f7f7f7full;
+		x = (x & 0x007f007f007f007full) | ((x & 0x7f007f007f007f00ull) >> 1);
+		x = (x & 0x00003fff00003fffull) | ((x & 0x3fff00003fff0000ull) >> 2);
+		v = (x & 0x000000000fffffffull) | ((x & 0x0fffffff00000000ull) >> 4);
+		return n;
+	}
+#endif
+
+	/**
+	 * Write 64 bit unsigned value to stream using variable length encoding.
+	 */
+	template<class S> static inline bool write(S& s, uint64_t v)
+	{
+		while(v >= 0x80)
+		{
+			if(!s.write(uint8_t(v | 0x80)))
+				return false;
+
+			v >>= 7;
+		}
+
+		return s.write(uint8_t(v));
+	}
+
+	/**
+	 * Read 64 bit unsigned variable length coded value from stream.
+	 *
+	 * The tenth byte is always the last one, like the fifth one for VarUint4.
+	 */
+	template<class S> static inline bool read(S& s, uint64_t &v)
+	{
+#if RPC_VARINT_SWAR
+		if constexpr(detail::hasContiguous((S*)nullptr))
+		{
+			size_t length;
+			const auto p = s.contiguous(length);
+
+			if(length >= sizeof(uint64_t))
+			{
+				if(const auto n = decode(p, v))
+				{
+					return s.skip(n);
+				}
+			}
+		}
+#endif
+
+		v = 0;
+
+		for(unsigned int shift = 0; shift < 64; shift += 7)
+		{
+			uint8_t d;
+			if(!s.read(d))
+				return false;
+
+			v |= uint64_t(d & 0x7f) << shift;
+
+			if(!(d & 0x80))
+				break;
+		}
+
+		return true;
+	}
+
+	/**
+	 * Skip a variable length encoded value in stream.
+	 */
+	template<class S> static inline bool skip(S& s)
+	{
+		uint8_t d;
+
+		for(unsigned int nBytes = 0; nBytes < 10; nBytes++)
+		{
+			if(!s.read(d))
+				return false;
+
+			if(!(d & 0x80))
+				break;
+		}
+
+		return true;
+	}
+};
+
+/**
+ * Variable length encoding for signed 64 bit values.
+ *
+ * The value is mapped to an unsigned one by zigzag encoding (0, -1, 1, -2, 2 ...
+ * becomes 0, 1, 2, 3, 4 ...), so that small negative values are also encoded
+ * into few bytes, then it is written using VarUint8.
+ */
+struct VarInt8
+{
+	static constexpr size_t maxLength = VarUint8::maxLength;
+
+	static constexpr inline uint64_t zigzag(int64_t v) {
+		return (uint64_t(v) << 1) ^ (v < 0 ? ~0ull : 0ull);
+	}
+
+	static constexpr inline int64_t unzigzag(uint64_t v) {
+		return int64_t((v >> 1) ^ (0ull - (v & 1)));
+	}
+
+	static constexpr inline size_t size(int64_t c) {
+		return VarUint8::size(zigzag(c));
+	}
+
+	template<class S> static inline bool write(S& s, int64_t v) {
+		return VarUint8::write(s, zigzag(v));
+	}
+
+	template<class S> static inline bool read(S& s, int64_t &v)
+	{
+		uint64_t u;
+
+		if(!VarUint8::read(s, u))
+			return false;
+
+		v = unzigzag(u);
+		return true;
+	}
+
+	template<class S> static inline bool skip(S& s) {
+		return VarUint8::skip(s);
+	}
+};
+
 }
 
 #endif /* _RPCVARINT_H_ */
@@ -13,6 +13,8 @@ namespace detail
     struct true_type { static constexpr auto value = true; };
     template<class> struct is_lvalue_reference: public false_type { };
     template<class T> struct is_lvalue_reference<T&>: public true_type { };
+    template<class, class> struct is_same: public false_type { };
+    template<class T> struct is_same<T, T>: public true_type { };
 
     template<class> struct return_type;
     template<class R, class... As> struct return_type<R(As...)> { using T = R; };
@@ -8,8 +8,10 @@
 #include "platform/StlAdapters.h"
 
 #include <mutex>
+#include <deque>
+#include <memory>
 #include <future>
-#include <condition_variable>
+#include <functional>
 
 namespace rpc {
 
@@ -18,62 +20,59 @@ class ClientBase: public Endpoint, Tracker
 {
 	template<class, class, size_t> friend class SessionBase;
 
-    volatile bool locked;
-    std::mutex m;
-    std::condition_variable cv;
-
-    inline void waitLookup()
-    {
-    	if(locked)
-    	{
-    		std::unique_lock<std::mutex> l(m);
-
-    		while(locked)
-    		{
-    			cv.wait(l);
-    		}
-    	}
-    }
-
-    inline void suspendCalls()
-    {
-   		std::lock_guard l(m);
-   		locked = true;
-    }
-
-    inline void resumeCalls()
-	{
-		std::lock_guard l(m);
-		locked = false;
-		cv.notify_all();
-	}
-
 protected:
+	/**
+	 * Lazily looked up remote method.
+	 *
+	 * The symbol is looked up on the first call, calls made while the lookup is in
+	 * progress are queued for this symbol only and sent together in order once the
+	 * identifier is known. Calls to other (already resolved) symbols are not held up.
+	 */
 	template<class Sym> class OnDemand
 	{
-		volatile bool lookupDone = false;
-		typename Sym::CallType callId;
-		const Sym& sym;
+		using CallType = typename Sym::CallType;
 
-		template<class Rpc, class = void> struct Lock{
-			inline Lock(Rpc&) {}
-		};
+		/**
+		 * Calls waiting for the lookup to complete.
+		 */
+		using Pending = std::function<void(const CallType&)>;
 
-		template<class Rpc>
-		struct Lock<Rpc, decltype(Rpc::lock)>
-		{
-			Rpc& rpc;
+		enum class State { idle, pending, done };
 
-			Lock(Rpc& rpc): rpc(rpc)
-			{
-				rpc.lock();
-			}
+		std::mutex m;
+		State state = State::idle;
+		std::deque<Pending> pending;
+		CallType callId;
+		const Sym& sym;
 
-			~Lock()
+		/**
+		 * Send the queued calls until there are no more left, then let the new calls through.
+		 */
+		inline void flush(const CallType& result)
+		{
+			while(true)
 			{
-				rpc.unlock();
+				std::deque<Pending> batch;
+
+				{
+					std::lock_guard _(m);
+
+					if(pending.empty())
+					{
+						callId = result;
+						state = State::done;
+						return;
+					}
+
+					batch.swap(pending);
+				}
+
+				for(auto& send: batch)
+				{
+					send(result);
+				}
 			}
-		};
+		}
 
 	public:
 		constexpr OnDemand(const Sym& sym): sym(sym) {}
@@ -81,30 +80,54 @@ protected:
 		template<class Rpc, class... Args>
 		inline auto call(Rpc& rpc, Args&&... args)
 		{
-			if(lookupDone)
+			std::unique_lock l(m);
+
+			if(state == State::done)
 			{
-				rpc.waitLookup();
-				rpc.call(this->callId, rpc::forward<Args>(args)...);
+				const auto id = callId;
+				l.unlock();
+
+				rpc.call(id, rpc::forward<Args>(args)...);
+				return;
 			}
-			else
+
+			pending.emplace_back([&rpc, args...](const CallType& id) mutable {
+				rpc.call(id, rpc::move(args)...);
+			});
+
+			if(state == State::pending)
 			{
-				rpc.suspendCalls();
-				rpc.lookup(sym, [=, &rpc](Rpc&, bool done, typename Sym::CallType result) mutable
+				return;
+			}
+
+			state = State::pending;
+			l.unlock();
+
+			auto err = rpc.lookup(sym, [this](Rpc&, bool done, CallType result)
+			{
+				if(!done)
 				{
-					if(done)
-					{
-						rpc.call(result, rpc::forward<Args>(args)...);
-						rpc.resumeCalls();
+					fail("failed to look up symbol '", (const char*)sym, "'");
+				}
 
-						Lock<Rpc> _(rpc);
-						this->callId = result;
-						this->lookupDone = true;
-					}
-					else
-					{
-						fail("failed to look up symbol '", (const char*)sym, "'");
-					}
-				});
+				this->flush(result);
+			});
+
+			if(!!err)
+			{
+				/*
+				 * The queued calls (including the ones that other threads added in the
+				 * meantime) are dropped, the next call starts a new lookup.
+				 */
+				std::deque<Pending> dropped;
+
+				{
+					std::lock_guard _(m);
+					dropped.swap(pending);
+					state = State::idle;
+				}
+
+				fail("failed to send lookup for symbol '", (const char*)sym, "'");
 			}
 		}
 	};
@@ -0,0 +1,66 @@
+#ifndef _RPCSYMBOLCACHE_H_
+#define _RPCSYMBOLCACHE_H_
+
+#include <unordered_map>
+#include <mutex>
+
+#include <cstdint>
+
+namespace rpc {
+
+/**
+ * Cache of symbol lookup results keyed by the contract fingerprint of the remote end.
+ *
+ * Can be shared by the connections to the same (kind of) service, for use with
+ * Endpoint::lookupAllCached. If a new connection reports a known fingerprint, the
+ * identifiers resolved earlier are used without looking them up again.
+ */
+class SymbolCache
+{
+    std::unordered_map<uint32_t, std::unordered_map<uint64_t, uint32_t>> contracts;
+    std::mutex mut;
+
+public:
+    /**
+     * Get the identifier of a symbol for a contract, returns false if it is not known.
+     */
+    inline bool get(uint32_t fingerprint, uint64_t symbolHash, uint32_t &id)
+    {
+        std::lock_guard _(mut);
+
+        auto contract = contracts.find(fingerprint);
+
+        if(contract == contracts.end())
+            return false;
+
+        auto it = contract->second.find(symbolHash);
+
+        if(it == contract->second.end())
+            return false;
+
+        id = it->second;
+        return true;
+    }
+
+    /**
+     * Store the identifier of a symbol for a contract.
+     */
+    inline void put(uint32_t fingerprint, uint64_t symbolHash, uint32_t id)
+    {
+        std::lock_guard _(mut);
+        contracts[fingerprint][symbolHash] = id;
+    }
+
+    /**
+     * Drop all cached entries.
+     */
+    inline void clear()
+    {
+        std::lock_guard _(mut);
+        contracts.clear();
+    }
+};
+
+}
+
+#endif /* _RPCSYMBOLCACHE_H_ */
@@ -0,0 +1,177 @@
+#ifndef _RPCBUFFERPOOL_H_
+#define _RPCBUFFERPOOL_H_
+
+#include <memory>
+#include <mutex>
+
+#include <cstring>
+#include <cstdint>
+
+namespace rpc {
+
+/**
+ * Size-classed cache of message buffers.
+ *
+ * Buffers are allocated in power of two size classes, released buffers are
+ * kept on a per class free list for later reuse, so the message path does not
+ * need to touch the heap in the steady state. Requests bigger than the largest
+ * size class are served directly from the heap.
+ *
+ * It can be shared between endpoints (for example one pool per thread) or used
+ * per endpoint, all operations are thread safe. The pool must outlive all the
+ * buffers allocated from it.
+ */
+class BufferPool
+{
+    static constexpr size_t minClassShift = 6;
+
+public:
+    /**
+     * Number of size classes, from 64 bytes to 64 kilobytes.
+     */
+    static constexpr size_t nClasses = 11;
+
+    /**
+     * Maximal number of free buffers kept per size class.
+     */
+    static constexpr size_t maxCachedPerClass = 32;
+
+    /**
+     * Allocation counters.
+     */
+    struct Statistics
+    {
+        size_t heapAllocations = 0; //!< Number of buffers allocated from the heap.
+        size_t heapReleases = 0;    //!< Number of buffers returned to the heap.
+        size_t poolHits = 0;        //!< Number of requests served from a free list.
+    };
+
+    /**
+     * Deleter for buffers that may have been allocated from a pool.
+     */
+    struct Deleter
+    {
+        BufferPool* pool = nullptr;
+        uint8_t sizeClass = 0;
+
+        inline void operator()(char* p) const
+        {
+            if(pool)
+            {
+                pool->release(p, sizeClass);
+            }
+            else
+            {
+                delete[] p;
+            }
+        }
+    };
+
+    using Buffer = std::unique_ptr<char[], Deleter>;
+
+private:
+    std::mutex mut;
+    char* freeList[nClasses] = {nullptr, };
+    size_t nFree[nClasses] = {0, };
+    Statistics stats;
+
+    static inline uint8_t classOf(size_t size)
+    {
+        uint8_t ret = 0;
+
+        while(ret < nClasses && (size_t(1) << (ret + minClassShift)) < size)
+        {
+            ret++;
+        }
+
+        return ret;
+    }
+
+    static inline char* next(char* p)
+    {
+        char* ret;
+        memcpy(&ret, p, sizeof(ret));
+        return ret;
+    }
+
+    inline void release(char* p, uint8_t sizeClass)
+    {
+        std::lock_guard _(mut);
+
+        if(sizeClass < nClasses && nFree[sizeClass] < maxCachedPerClass)
+        {
+            memcpy(p, &freeList[sizeClass], sizeof(char*));
+            freeList[sizeClass] = p;
+            nFree[sizeClass]++;
+        }
+        else
+        {
+            stats.heapReleases++;
+            delete[] p;
+        }
+    }
+
+public:
+    inline BufferPool() = default;
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    inline ~BufferPool()
+    {
+        for(auto p: freeList)
+        {
+            while(p)
+            {
+                auto n = next(p);
+                delete[] p;
+                p = n;
+            }
+        }
+    }
+
+    /**
+     * Get a buffer of at least the requested size.
+     */
+    inline Buffer allocate(size_t size)
+    {
+        const auto sizeClass = classOf(size);
+
+        std::lock_guard _(mut);
+
+        if(sizeClass < nClasses)
+        {
+            if(auto p = freeList[sizeClass])
+            {
+                freeList[sizeClass] = next(p);
+                nFree[sizeClass]--;
+                stats.poolHits++;
+                return Buffer(p, Deleter{this, sizeClass});
+            }
+
+            size = size_t(1) << (sizeClass + minClassShift);
+        }
+
+        stats.heapAllocations++;
+        return Buffer(new char[size], Deleter{this, sizeClass});
+    }
+
+    /**
+     * Get a buffer from the pool if specified or from the heap otherwise.
+     */
+    static inline Buffer allocate(BufferPool* pool, size_t size) {
+        return pool ? pool->allocate(size) : Buffer(new char[size]);
+    }
+
+    /**
+     * Get a snapshot of the allocation counters.
+     */
+    inline Statistics getStatistics()
+    {
+        std::lock_guard _(mut);
+        return stats;
+    }
+};
+
+}
+
+#endif /* _RPCBUFFERPOOL_H_ */
@@ -0,0 +1,367 @@
+#ifndef _RPCCONCURRENTREGISTRY_H_
+#define _RPCCONCURRENTREGISTRY_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <type_traits>
+
+#include <cstdint>
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace rpc {
+
+namespace detail {
+
+/**
+ * Per thread announcement of lookups in progress, shared by all ConcurrentRegistry instances.
+ *
+ * Every thread that does a lookup gets its own slot (on its own cache line), in
+ * which it flips a sequence counter to odd when starting and back to even when
+ * done. Only the owner thread writes the counter, so entering and leaving are
+ * plain stores, there is no shared state modified by the readers.
+ *
+ * The slots form a list that only grows, the slot of an exited thread is reused
+ * by the next new one. A writer that needs to wait for the lookups that might
+ * still see the previous state takes a snapshot of the counters and waits for the
+ * odd ones to change.
+ *
+ * The store-load ordering between announcing a lookup and reading the table is
+ * provided by the process wide memory barrier system call issued by the writers
+ * (if the kernel supports it), so that readers only need a compiler barrier.
+ */
+class ReaderSlots
+{
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> sequence = {0};
+        std::atomic<bool> used = {true};
+        Slot* next = nullptr;
+    };
+
+    /**
+     * Claims a slot for the thread on first use and releases it on exit.
+     */
+    struct Owner
+    {
+        Slot* const slot = claim();
+
+        inline ~Owner() {
+            slot->used.store(false, std::memory_order_release);
+        }
+    };
+
+    static inline std::atomic<Slot*> head = {nullptr};
+    static inline const bool expedited = syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+
+    static inline Slot* claim()
+    {
+        for(auto s = head.load(std::memory_order_acquire); s; s = s->next)
+        {
+            bool expected = false;
+
+            if(!s->used.load(std::memory_order_relaxed) && s->used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return s;
+            }
+        }
+
+        auto s = new Slot;
+        s->next = head.load(std::memory_order_relaxed);
+
+        while(!head.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed));
+
+        return s;
+    }
+
+    static inline Slot& own()
+    {
+        static thread_local Owner owner;
+        return *owner.slot;
+    }
+
+public:
+    /**
+     * Announce a lookup in progress on the calling thread, returns the value to be passed to leave.
+     */
+    static inline uint64_t enter()
+    {
+        auto& s = own();
+        const auto seq = s.sequence.load(std::memory_order_relaxed) + 1;
+        s.sequence.store(seq, std::memory_order_relaxed);
+
+        if(expedited)
+        {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+        else
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        return seq;
+    }
+
+    static inline void leave(uint64_t seq) {
+        own().sequence.store(seq + 1, std::memory_order_release);
+    }
+
+    /**
+     * Wait for the lookups that were in progress when the last modification was made.
+     */
+    static inline void synchronize()
+    {
+        if(!expedited || syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) != 0)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        for(auto s = head.load(std::memory_order_acquire); s; s = s->next)
+        {
+            if(const auto seq = s->sequence.load(std::memory_order_acquire); seq & 1)
+            {
+                while(s->sequence.load(std::memory_order_acquire) == seq)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+};
+
+/**
+ * Registry with lookups that never take a lock, usable in place of HashMapRegistry.
+ *
+ * It is an open addressing hash table (linear probing), whose slots point to
+ * separately allocated immutable nodes that hold the key and the value. Lookups
+ * only announce their presence in the slot of their own thread (see ReaderSlots),
+ * modifications are serialized by a mutex and memory that might be seen by readers
+ * (removed nodes and the previous table after resizing) is only freed after the
+ * lookups that were in progress during the change are finished.
+ *
+ * As with HashMapRegistry the pointer returned by find remains valid until the
+ * entry is removed. Removal waits for concurrent lookups to finish (outside of
+ * the lock, so it does not hold up other modifications), which is a short,
+ * bounded amount of time.
+ */
+template<class K, class V>
+class ConcurrentRegistry
+{
+    static_assert(std::is_integral_v<K>, "ConcurrentRegistry supports integral keys only");
+
+    struct Node
+    {
+        const K key;
+        V value;
+    };
+
+    struct Table
+    {
+        const size_t mask;
+        std::unique_ptr<std::atomic<Node*>[]> slots;
+
+        inline Table(size_t size): mask(size - 1), slots(new std::atomic<Node*>[size])
+        {
+            for(size_t i = 0; i < size; i++)
+            {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    static constexpr size_t initialSize = 16;
+
+    std::atomic<Table*> table;
+
+    std::mutex writeLock;
+    size_t nLive = 0, nUsed = 0;
+
+    /**
+     * Marks a slot whose entry was removed, lookups need to continue probing after it.
+     */
+    static inline Node* tombstone() {
+        return reinterpret_cast<Node*>(uintptr_t(1));
+    }
+
+    static inline size_t hash(const K& k) {
+        return size_t((uint64_t(k) * 0x9e3779b97f4a7c15ull) >> 32);
+    }
+
+    /**
+     * Find the slot of a key in the current table, for writers only.
+     */
+    inline std::atomic<Node*>* locate(Table* t, const K& k)
+    {
+        for(auto i = hash(k) & t->mask; auto n = t->slots[i].load(std::memory_order_relaxed); i = (i + 1) & t->mask)
+        {
+            if(n != tombstone() && n->key == k)
+            {
+                return &t->slots[i];
+            }
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Replace the table with one that has no tombstones and is at most half full.
+     *
+     * Returns the previous table, which must be freed after synchronization.
+     */
+    inline Table* rehash()
+    {
+        auto size = initialSize;
+
+        while(size < (nLive + 1) * 2)
+        {
+            size *= 2;
+        }
+
+        auto old = table.load(std::memory_order_relaxed);
+        auto t = new Table(size);
+
+        for(size_t i = 0; i <= old->mask; i++)
+        {
+            auto n = old->slots[i].load(std::memory_order_relaxed);
+
+            if(n && n != tombstone())
+            {
+                auto j = hash(n->key) & t->mask;
+
+                while(t->slots[j].load(std::memory_order_relaxed))
+                {
+                    j = (j + 1) & t->mask;
+                }
+
+                t->slots[j].store(n, std::memory_order_relaxed);
+            }
+        }
+
+        table.store(t, std::memory_order_release);
+        nUsed = nLive;
+        return old;
+    }
+
+public:
+    inline ConcurrentRegistry(): table(new Table(initialSize)) {}
+
+    ConcurrentRegistry(const ConcurrentRegistry&) = delete;
+    ConcurrentRegistry& operator=(const ConcurrentRegistry&) = delete;
+
+    inline ~ConcurrentRegistry()
+    {
+        auto t = table.load();
+
+        for(size_t i = 0; i <= t->mask; i++)
+        {
+            auto n = t->slots[i].load(std::memory_order_relaxed);
+
+            if(n != tombstone())
+            {
+                delete n;
+            }
+        }
+
+        delete t;
+    }
+
+    inline bool remove(const K& k)
+    {
+        Node* n;
+
+        {
+            std::lock_guard _(writeLock);
+
+            auto slot = locate(table.load(std::memory_order_relaxed), k);
+
+            if(!slot)
+                return false;
+
+            n = slot->load(std::memory_order_relaxed);
+            slot->store(tombstone(), std::memory_order_release);
+            nLive--;
+        }
+
+        ReaderSlots::synchronize();
+        delete n;
+        return true;
+    }
+
+    inline bool add(const K& k, V&& v)
+    {
+        Table* old = nullptr;
+
+        {
+            std::lock_guard _(writeLock);
+
+            auto t = table.load(std::memory_order_relaxed);
+
+            if(locate(t, k))
+                return false;
+
+            if((nUsed + 1) * 4 > (t->mask + 1) * 3)
+            {
+                old = rehash();
+                t = table.load(std::memory_order_relaxed);
+            }
+
+            auto i = hash(k) & t->mask;
+
+            while(true)
+            {
+                auto n = t->slots[i].load(std::memory_order_relaxed);
+
+                if(!n || n == tombstone())
+                {
+                    nUsed += !n;
+                    break;
+                }
+
+                i = (i + 1) & t->mask;
+            }
+
+            t->slots[i].store(new Node{k, std::move(v)}, std::memory_order_release);
+            nLive++;
+        }
+
+        if(old)
+        {
+            ReaderSlots::synchronize();
+            delete old;
+        }
+
+        return true;
+    }
+
+    inline V* find(const K& k, bool &ok)
+    {
+        const auto seq = ReaderSlots::enter();
+        V* ret = nullptr;
+
+        auto t = table.load(std::memory_order_acquire);
+
+        for(auto i = hash(k) & t->mask; auto n = t->slots[i].load(std::memory_order_acquire); i = (i + 1) & t->mask)
+        {
+            if(n != tombstone() && n->key == k)
+            {
+                ret = &n->value;
+                break;
+            }
+        }
+
+        ReaderSlots::leave(seq);
+
+        ok = ret != nullptr;
+        return ret;
+    }
+};
+
+}
+
+}
+
+#endif /* _RPCCONCURRENTREGISTRY_H_ */
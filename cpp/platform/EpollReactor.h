@@ -0,0 +1,594 @@
+#ifndef _RPCEPOLLREACTOR_H_
+#define _RPCEPOLLREACTOR_H_
+
+#include "FdStreamAdapter.h"
+
+#include <functional>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+namespace rpc {
+
+/**
+ * Single threaded event loop based on epoll.
+ *
+ * It dispatches readiness events of non-blocking file descriptors to the
+ * registered handler objects, which allows many connections to be served
+ * by a single thread. Other threads can hand over work to the loop thread
+ * using the post method.
+ */
+class EpollReactor
+{
+public:
+    /**
+     * Interface of objects that can be registered for events.
+     */
+    struct Handler
+    {
+        /**
+         * Handle the (EPOLLIN, EPOLLOUT, ...) events reported for the registered descriptor.
+         */
+        virtual void onEvents(uint32_t events) = 0;
+
+        inline virtual ~Handler() = default;
+    };
+
+private:
+    static constexpr int maxEvents = 64;
+
+    /**
+     * Executes the jobs posted from other threads when the event descriptor is signaled.
+     */
+    class Waker: public Handler
+    {
+        EpollReactor& reactor;
+
+        virtual void onEvents(uint32_t) override final
+        {
+            uint64_t dummy;
+            while(read(reactor.wakeFd, &dummy, sizeof(dummy)) < 0 && errno == EINTR);
+
+            std::vector<std::function<void()>> jobs;
+
+            {
+                std::lock_guard _(reactor.postLock);
+                jobs.swap(reactor.posted);
+            }
+
+            for(auto& job: jobs)
+            {
+                job();
+            }
+        }
+
+    public:
+        inline Waker(EpollReactor& reactor): reactor(reactor) {}
+    };
+
+    int epfd, wakeFd;
+    std::atomic<bool> stopRequested = false;
+
+    std::mutex postLock;
+    std::vector<std::function<void()>> posted;
+    Waker waker;
+
+    /**
+     * Events being dispatched, entries are cleared if the handler is removed meanwhile.
+     */
+    struct epoll_event events[maxEvents];
+    int nEvents = 0, current = 0;
+
+    inline void wake()
+    {
+        const uint64_t one = 1;
+        while(write(wakeFd, &one, sizeof(one)) < 0 && errno == EINTR);
+    }
+
+public:
+    inline EpollReactor():
+        epfd(epoll_create1(EPOLL_CLOEXEC)),
+        wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+        waker(*this)
+    {
+        if(epfd < 0 || wakeFd < 0 || !add(wakeFd, EPOLLIN, &waker))
+        {
+            fail("could not create epoll instance"); /* GCOV_EXCL_LINE */
+        }
+    }
+
+    EpollReactor(const EpollReactor&) = delete;
+    EpollReactor& operator=(const EpollReactor&) = delete;
+
+    inline ~EpollReactor()
+    {
+        close(wakeFd);
+        close(epfd);
+    }
+
+    /**
+     * Put a file descriptor in non-blocking mode.
+     */
+    static inline bool setNonBlocking(int fd)
+    {
+        const auto flags = fcntl(fd, F_GETFL);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    /**
+     * Register a handler for the specified events of a descriptor.
+     */
+    inline bool add(int fd, uint32_t events, Handler* h)
+    {
+        struct epoll_event ev = {};
+        ev.events = events;
+        ev.data.ptr = h;
+        return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+
+    /**
+     * Change the set of events the handler of a descriptor is interested in.
+     */
+    inline bool modify(int fd, uint32_t events, Handler* h)
+    {
+        struct epoll_event ev = {};
+        ev.events = events;
+        ev.data.ptr = h;
+        return epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == 0;
+    }
+
+    /**
+     * Unregister the handler of a descriptor.
+     *
+     * It is safe to be called from a handler, even for a different
+     * handler than the one being executed.
+     */
+    inline bool remove(int fd, Handler* h)
+    {
+        for(int i = current; i < nEvents; i++)
+        {
+            if(events[i].data.ptr == h)
+            {
+                events[i].data.ptr = nullptr;
+            }
+        }
+
+        return epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr) == 0;
+    }
+
+    /**
+     * Wait for events at most for the specified time (in milliseconds, -1 means infinite)
+     * and dispatch them.
+     *
+     * Returns the number of events processed or -1 on error.
+     */
+    inline int runOnce(int timeout)
+    {
+        nEvents = epoll_wait(epfd, events, maxEvents, timeout);
+
+        if(nEvents < 0)
+        {
+            nEvents = 0;
+            return errno == EINTR ? 0 : -1;
+        }
+
+        for(current = 0; current < nEvents; current++)
+        {
+            if(auto h = static_cast<Handler*>(events[current].data.ptr))
+            {
+                h->onEvents(events[current].events);
+            }
+        }
+
+        const auto ret = nEvents;
+        nEvents = current = 0;
+        return ret;
+    }
+
+    /**
+     * Dispatch events until stopped or an error occurs.
+     */
+    inline bool run()
+    {
+        while(!stopRequested.exchange(false))
+        {
+            if(runOnce(-1) < 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Make the run method return after processing the current events.
+     *
+     * Can be called from any thread, if the loop is not running at the
+     * moment, the next invocation of run returns immediately.
+     */
+    inline void stop()
+    {
+        stopRequested = true;
+        wake();
+    }
+
+    /**
+     * Schedule a job to be executed on the thread of the event loop.
+     *
+     * Can be called from any thread, this is the way to access endpoints
+     * served by the reactor from the outside.
+     */
+    template<class C>
+    inline void post(C&& job)
+    {
+        {
+            std::lock_guard _(postLock);
+            posted.emplace_back(std::forward<C>(job));
+        }
+
+        wake();
+    }
+
+    /**
+     * Start serving an endpoint using an EpollStreamAdapter as its IO engine.
+     *
+     * The specified functor is called after the connection is closed, because the peer
+     * hung up or there was an error. It is allowed to destroy the endpoint.
+     */
+    template<class Ep, class C>
+    inline bool attach(Ep& ep, C&& onClosed);
+};
+
+/**
+ * Message transport adapter for a non-blocking byte stream descriptor driven by an EpollReactor.
+ *
+ * Incoming data is read when the descriptor is readable, complete frames are
+ * processed as soon as they arrive, partial ones are kept until the rest comes in.
+ * Outgoing messages are queued, replies sent during processing are written out in a
+ * single batch afterwards, the rest of the data that could not be written is sent
+ * when the descriptor becomes writable.
+ *
+ * The adapter takes ownership of the descriptor. The endpoint must only be used
+ * on the thread that runs the event loop.
+ */
+class EpollStreamAdapter: EpollReactor::Handler
+{
+    friend EpollReactor;
+
+    using Processor = Errors (*)(EpollStreamAdapter&, PreallocatedMemoryBufferStream::Accessor&);
+
+    static constexpr size_t defaultReceiveBufferSize = 16 * 1024;
+
+    EpollReactor& reactor;
+    int fd;
+
+    BufferPool ownPool;
+    BufferPool* pool = &ownPool;
+
+    ReceiveBuffer rxBuffer;
+    SendQueue txQueue;
+
+    Processor processor = nullptr;
+    std::function<void()> onClosed, onDrained;
+
+    bool registered = false, dispatching = false, writeArmed = false, failed = false;
+
+    inline uint32_t eventMask() const {
+        return EPOLLIN | EPOLLRDHUP | (writeArmed ? uint32_t(EPOLLOUT) : 0u);
+    }
+
+    /**
+     * Write as much as possible and wait for write readiness if there is more.
+     */
+    inline bool flushQueue()
+    {
+        const bool hadPending = !txQueue.empty();
+
+        if(txQueue.writeTo(fd) == SendQueue::WriteResult::failed)
+        {
+            return false;
+        }
+
+        const bool needArmed = !txQueue.empty();
+
+        if(needArmed != writeArmed)
+        {
+            writeArmed = needArmed;
+
+            if(!reactor.modify(fd, eventMask(), this))
+            {
+                return false;
+            }
+        }
+
+        if(hadPending && !needArmed && onDrained)
+        {
+            onDrained();
+        }
+
+        return true;
+    }
+
+    inline bool readAvailable()
+    {
+        while(true)
+        {
+            size_t length;
+            auto ptr = rxBuffer.freeSpace(length);
+            auto r = read(fd, ptr, length);
+
+            if(r < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+
+            if(r == 0)
+            {
+                return false;
+            }
+
+            rxBuffer.commit(r);
+
+            size_t count;
+            auto ok = rxBuffer.dispatch([this](PreallocatedMemoryBufferStream&& s)
+            {
+                auto a = s.access();
+                auto err = processor(*this, a);
+                return getExpectedExecutorBehavior(err) != ExpectedExecutorBehavior::Die;
+            }, count);
+
+            if(!ok || failed)
+            {
+                return false;
+            }
+
+            if(size_t(r) < length)
+            {
+                return true;
+            }
+        }
+    }
+
+    inline void shutdown()
+    {
+        if(registered)
+        {
+            reactor.remove(fd, this);
+            registered = false;
+        }
+
+        if(onClosed)
+        {
+            auto cb = std::move(onClosed);
+            onClosed = nullptr;
+            cb();
+        }
+    }
+
+    virtual void onEvents(uint32_t events) override final
+    {
+        bool ok = true;
+
+        if(events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        {
+            dispatching = true;
+            ok = readAvailable();
+            dispatching = false;
+        }
+
+        if(ok && (events & EPOLLOUT || !txQueue.empty()))
+        {
+            ok = flushQueue();
+        }
+
+        if(!ok)
+        {
+            shutdown();
+        }
+    }
+
+    template<class Ep, class C>
+    inline bool start(C&& cb)
+    {
+        processor = [](EpollStreamAdapter& self, PreallocatedMemoryBufferStream::Accessor& a) -> Errors {
+            return static_cast<Ep&>(self).process(a);
+        };
+
+        onClosed = std::forward<C>(cb);
+
+        if(!EpollReactor::setNonBlocking(fd) || !reactor.add(fd, eventMask(), this))
+        {
+            return false;
+        }
+
+        registered = true;
+        return true;
+    }
+
+public:
+    using InputAccessor = PreallocatedMemoryBufferStream::Accessor;
+
+    EpollStreamAdapter(const EpollStreamAdapter&) = delete;
+
+    inline EpollStreamAdapter(EpollReactor& reactor, int fd, size_t receiveBufferSize = defaultReceiveBufferSize):
+        reactor(reactor), fd(fd)
+    {
+        rxBuffer.resize(receiveBufferSize);
+    }
+
+    inline ~EpollStreamAdapter()
+    {
+        if(registered)
+        {
+            reactor.remove(fd, this);
+        }
+
+        close(fd);
+    }
+
+    /**
+     * Draw message buffers from an external pool instead of the adapter's own one.
+     *
+     * NOTE: must be called before the adapter is started.
+     */
+    inline void setBufferPool(BufferPool* pool) {
+        this->pool = pool;
+    }
+
+    /**
+     * Set the limit of the length of received frames (64MiB by default).
+     *
+     * A longer frame (or an invalid frame header) closes the connection.
+     */
+    inline void setMaxFrameLength(size_t length) {
+        rxBuffer.setMaxFrameLength(length);
+    }
+
+    inline auto messageFactory() {
+        return PreallocatedMemoryBufferStreamWriterFactory{pool};
+    }
+
+    /**
+     * Get the number of bytes sent but not written out yet.
+     *
+     * Memory referenced by sent messages (see ArrayReference) can be reused
+     * once it returns zero.
+     */
+    inline size_t pendingOutput() const {
+        return txQueue.size();
+    }
+
+    /**
+     * Set the functor to be called when all of the queued messages have been written out.
+     *
+     * It is called on the event loop thread, right after the send queue becomes empty,
+     * so it can be used to release or reuse the memory referenced by the messages sent
+     * before (see ArrayReference). It is allowed to send more messages.
+     */
+    template<class C>
+    inline void setDrainedCallback(C&& cb) {
+        onDrained = std::forward<C>(cb);
+    }
+
+    bool send(PreallocatedMemoryBufferStream&& data)
+    {
+        if(failed)
+        {
+            return false;
+        }
+
+        txQueue.push(std::move(data));
+
+        if(!dispatching && !writeArmed && !flushQueue())
+        {
+            failed = true;
+            return false;
+        }
+
+        return true;
+    }
+};
+
+template<class Ep, class C>
+inline bool EpollReactor::attach(Ep& ep, C&& onClosed) {
+    return ep.EpollStreamAdapter::template start<Ep>(std::forward<C>(onClosed));
+}
+
+/**
+ * Accepts incoming connections on a listening socket driven by an EpollReactor.
+ *
+ * The accepted descriptors are already in non-blocking mode when passed to the
+ * callback, which is expected to set up an endpoint for each of them.
+ *
+ * A spare descriptor is held open, so that when the process runs out of descriptors
+ * the pending connection can be accepted and dropped right away (by temporarily
+ * releasing the spare one), instead of it keeping the listening socket readable
+ * and the event loop spinning on it.
+ */
+class EpollListener: EpollReactor::Handler
+{
+    EpollReactor& reactor;
+    int fd;
+    int spare = openSpare();
+    std::function<void(int)> onAccepted;
+
+    static inline int openSpare() {
+        return open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+
+    /**
+     * Accept and close a connection using the spare descriptor, returns false if there was none.
+     */
+    inline bool dropPending()
+    {
+        if(spare < 0)
+        {
+            return false;
+        }
+
+        close(spare);
+        const auto conn = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if(conn >= 0)
+        {
+            close(conn);
+        }
+
+        spare = openSpare();
+        return conn >= 0;
+    }
+
+    virtual void onEvents(uint32_t) override final
+    {
+        while(true)
+        {
+            const auto conn = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+            if(conn < 0)
+            {
+                if(errno == EINTR || errno == ECONNABORTED)
+                    continue;
+
+                if((errno == EMFILE || errno == ENFILE) && dropPending())
+                    continue;
+
+                break;
+            }
+
+            onAccepted(conn);
+        }
+    }
+
+public:
+    template<class C>
+    inline EpollListener(EpollReactor& reactor, int fd, C&& onAccepted):
+        reactor(reactor), fd(fd), onAccepted(std::forward<C>(onAccepted))
+    {
+        if(!EpollReactor::setNonBlocking(fd) || !reactor.add(fd, EPOLLIN, this))
+        {
+            fail("could not register listening socket"); /* GCOV_EXCL_LINE */
+        }
+    }
+
+    EpollListener(const EpollListener&) = delete;
+
+    inline ~EpollListener()
+    {
+        reactor.remove(fd, this);
+
+        if(spare >= 0)
+        {
+            close(spare);
+        }
+    }
+};
+
+}
+
+#endif /* _RPCEPOLLREACTOR_H_ */
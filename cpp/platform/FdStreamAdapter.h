@@ -2,30 +2,145 @@
 #define _RPCFDSTREAMADAPTER_H_
 
 #include "StlAdapters.h"
+#include "BufferPool.h"
 
 #include <memory>
 #include <list>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include <cassert>
 #include <cstring>
+#include <cerrno>
 
+#include <poll.h>
 #include <unistd.h>
+#include <sys/uio.h>
 
 namespace rpc {
 
 class FdStreamAdapter;
+class ReceiveBuffer;
+class SendQueue;
 class PreallocatedMemoryBufferStreamWriterFactory;
+class GrowableMemoryBufferStreamWriterFactory;
+struct InlineMemoryBufferStreamWriter;
 
 class PreallocatedMemoryBufferStream
 {
-    std::unique_ptr<char[]> buffer;
+public:
+    /**
+     * Block of external memory sent as part of the message, without copying it.
+     */
+    struct Reference
+    {
+        size_t offset;      //!< Position in the payload (stored in the buffer) before which the block is inserted.
+        const char* data;
+        size_t length;
+    };
+
+    /**
+     * Size of the storage for short frames inside the stream object itself.
+     */
+    static constexpr size_t inlineCapacity = 48;
+
+private:
+    BufferPool::Buffer buffer;
     char *start, *end;
 
+    /**
+     * Beginning of the frame header (for outgoing messages).
+     */
+    char *frame;
+
+    /**
+     * External blocks of an outgoing message, in order.
+     */
+    std::vector<Reference> references;
+
+    /**
+     * Set if the frame is stored in _inlineStorage_, the pointers are rebased when moving.
+     */
+    bool inlined = false;
+    alignas(uint64_t) char inlineStorage[inlineCapacity];
+
+    inline void take(PreallocatedMemoryBufferStream& o)
+    {
+        buffer = std::move(o.buffer);
+        references = std::move(o.references);
+        inlined = o.inlined;
+
+        if(inlined)
+        {
+            memcpy(inlineStorage, o.inlineStorage, o.end - o.inlineStorage);
+            start = inlineStorage + (o.start - o.inlineStorage);
+            end = inlineStorage + (o.end - o.inlineStorage);
+            frame = inlineStorage + (o.frame - o.inlineStorage);
+        }
+        else
+        {
+            start = o.start;
+            end = o.end;
+            frame = o.frame;
+        }
+    }
+
+    /**
+     * Length of the whole frame to be written, including the referenced blocks.
+     */
+    inline size_t frameSize() const
+    {
+        size_t ret = end - frame;
+
+        for(const auto &r: references)
+        {
+            ret += r.length;
+        }
+
+        return ret;
+    }
+
+    /**
+     * Call the functor with each of the contiguous parts of the frame, in order.
+     */
+    template<class C>
+    inline void forEachPiece(C&& c) const
+    {
+        auto p = frame;
+
+        for(const auto &r: references)
+        {
+            const auto at = start + r.offset;
+            c(p, size_t(at - p));
+            c(r.data, r.length);
+            p = at;
+        }
+
+        c(p, size_t(end - p));
+    }
+
     friend FdStreamAdapter;
+    friend ReceiveBuffer;
+    friend SendQueue;
     friend PreallocatedMemoryBufferStreamWriterFactory;
+    friend GrowableMemoryBufferStreamWriterFactory;
+    friend InlineMemoryBufferStreamWriter;
+
+    inline PreallocatedMemoryBufferStream(BufferPool::Buffer &&buffer, size_t size): 
+        buffer(std::move(buffer)), start(this->buffer.get()), end(this->buffer.get() + size), frame(start) {}
+
+    /**
+     * Non-owning view of a message stored in a buffer managed by someone else.
+     */
+    inline PreallocatedMemoryBufferStream(char* start, char* end): start(start), end(end), frame(start) {}
 
-    inline PreallocatedMemoryBufferStream(std::unique_ptr<char[]> &&buffer, size_t size): 
-        buffer(std::move(buffer)), start(this->buffer.get()), end(this->buffer.get() + size) {}
+    /**
+     * Empty outgoing message in the inline storage, with space for the longest header reserved.
+     */
+    inline PreallocatedMemoryBufferStream():
+        start(inlineStorage + VarUint4::maxLength), end(inlineStorage + inlineCapacity), frame(start), inlined(true) {}
     
 public:
     struct Accessor
@@ -49,19 +164,101 @@ public:
             return true;
         }
 
+        /**
+         * Reading methods check the bounds and fail - instead of reading past the
+         * end of the message - if the data is truncated or malformed, which is
+         * then reported as a message format error.
+         */
         template<class T>
         bool read(T& v)
         {
             constexpr auto size = sizeof(T);
-            assert(size <= size_t(end - ptr));
+
+            if(size > size_t(end - ptr))
+                return false;
+
             memcpy(&v, ptr, size);
             ptr += size;
             return true;
         }
 
-        bool skip(size_t size)
+        /**
+         * Write the first _size_ bytes of a word (in memory order).
+         *
+         * The whole word is stored at once if there is room for it, the bytes
+         * after the first _size_ ones are overwritten later (or not sent).
+         */
+        bool writePrefix(uint64_t word, size_t size)
+        {
+            assert(size <= size_t(end - ptr));
+
+            if(sizeof(word) <= size_t(end - ptr))
+            {
+                memcpy(ptr, &word, sizeof(word));
+            }
+            else
+            {
+                memcpy(ptr, &word, size);
+            }
+
+            ptr += size;
+            return true;
+        }
+
+        /**
+         * Write a block of encoded elements with a single copy.
+         */
+        bool writeBlock(const void* data, size_t size)
         {
             assert(size <= size_t(end - ptr));
+            memcpy(ptr, data, size);
+            ptr += size;
+            return true;
+        }
+
+        /**
+         * Read a block of encoded elements with a single copy.
+         */
+        bool readBlock(void* data, size_t size)
+        {
+            if(size > size_t(end - ptr))
+                return false;
+
+            memcpy(data, ptr, size);
+            ptr += size;
+            return true;
+        }
+
+        bool skip(size_t size)
+        {
+            if(size > size_t(end - ptr))
+                return false;
+
+            ptr += size;
+            return true;
+        }
+
+        /**
+         * Get the unread part of the buffer, for decoders that work on memory directly.
+         */
+        const char* contiguous(size_t &length) const
+        {
+            length = end - ptr;
+            return ptr;
+        }
+
+        /**
+         * Get a pointer to the next _size_ bytes in the buffer and move past them.
+         *
+         * Used by view types (e.g. std::string_view) to refer to the received data
+         * in place, the pointer is valid as long as the message is being processed.
+         */
+        bool borrow(const char* &out, size_t size)
+        {
+            if(size > size_t(end - ptr))
+                return false;
+
+            out = ptr;
             ptr += size;
             return true;
         }
@@ -71,11 +268,23 @@ public:
         return Accessor(start, end);
     }
 
-    inline PreallocatedMemoryBufferStream(PreallocatedMemoryBufferStream&&) = default;
-    inline PreallocatedMemoryBufferStream& operator =(PreallocatedMemoryBufferStream&&) = default;
-    inline PreallocatedMemoryBufferStream(size_t size):
-        buffer(new char[size]),
-        start(buffer.get()), end(buffer.get() + size)
+    inline PreallocatedMemoryBufferStream(PreallocatedMemoryBufferStream&& o) noexcept {
+        take(o);
+    }
+
+    inline PreallocatedMemoryBufferStream& operator =(PreallocatedMemoryBufferStream&& o) noexcept
+    {
+        if(this != &o)
+        {
+            take(o);
+        }
+
+        return *this;
+    }
+
+    inline PreallocatedMemoryBufferStream(size_t size, BufferPool* pool = nullptr):
+        buffer(BufferPool::allocate(pool, size)),
+        start(buffer.get()), end(buffer.get() + size), frame(start)
     {
         auto a = access();
         assert(size == (size_t)((uint32_t)size));
@@ -83,20 +292,105 @@ public:
         assert(lengthWriteOk);
         start = a.ptr;
     };
+
+    /**
+     * Full frame length (the value of the frame header) for a payload of the specified length.
+     *
+     * The header encodes the length of the whole frame including itself, which
+     * may need an extra byte if adding the header crosses an encoding boundary.
+     */
+    static inline size_t frameLength(size_t payload)
+    {
+        const auto v = payload + VarUint4::size((uint32_t)payload);
+        return v + (VarUint4::size((uint32_t)v) - VarUint4::size((uint32_t)payload));
+    }
+
+    /**
+     * Default limit of the length of received frames.
+     */
+    static constexpr size_t defaultMaxFrameLength = 64 * 1024 * 1024;
+
+    /**
+     * Get the payload length from a received frame header value.
+     *
+     * Fails if the value is less than the length of the header itself or if
+     * it exceeds the limit, a stream with such a frame can not be processed
+     * further, as the boundary of the next frame is not known.
+     */
+    static inline bool payloadLength(uint32_t header, size_t limit, size_t &payload)
+    {
+        const auto headerLength = VarUint4::size(header);
+
+        if(header < headerLength || limit < header)
+            return false;
+
+        payload = header - headerLength;
+        return true;
+    }
 };
 
 struct PreallocatedMemoryBufferStreamWriter: PreallocatedMemoryBufferStream, PreallocatedMemoryBufferStream::Accessor {
-    inline PreallocatedMemoryBufferStreamWriter(size_t s): 
-        PreallocatedMemoryBufferStream(s + VarUint4::size((uint32_t)s)),
+    inline PreallocatedMemoryBufferStreamWriter(size_t s, BufferPool* pool = nullptr): 
+        PreallocatedMemoryBufferStream(frameLength(s), pool),
+        PreallocatedMemoryBufferStream::Accessor(this->access()) {}
+};
+
+/**
+ * Writer for short messages, that stores the frame in the stream object (without a separate buffer).
+ *
+ * Used for messages whose maximal size is known in compile time to fit (see maxSerializedSize),
+ * so that neither the size of the message needs to be determined nor a buffer allocated for it.
+ * The header is written right before the payload when the message is complete.
+ */
+struct InlineMemoryBufferStreamWriter: PreallocatedMemoryBufferStream, PreallocatedMemoryBufferStream::Accessor
+{
+    /**
+     * Maximal length of the payload.
+     */
+    static constexpr size_t capacity = inlineCapacity - VarUint4::maxLength;
+
+    inline InlineMemoryBufferStreamWriter():
         PreallocatedMemoryBufferStream::Accessor(this->access()) {}
+
+    InlineMemoryBufferStreamWriter(const InlineMemoryBufferStreamWriter&) = delete;
+    InlineMemoryBufferStreamWriter(InlineMemoryBufferStreamWriter&&) = delete;
+
+    inline PreallocatedMemoryBufferStream finish()
+    {
+        const size_t payload = PreallocatedMemoryBufferStream::Accessor::ptr - start;
+        const auto total = frameLength(payload);
+
+        frame = start - (total - payload);
+        PreallocatedMemoryBufferStream::Accessor a(frame, start);
+        auto lengthWriteOk = VarUint4::write(a, (uint32_t)total);
+        assert(lengthWriteOk);
+
+        PreallocatedMemoryBufferStream::end = PreallocatedMemoryBufferStream::Accessor::ptr;
+        return static_cast<PreallocatedMemoryBufferStream&&>(*this);
+    }
 };
 
 struct PreallocatedMemoryBufferStreamWriterFactory
 {
     using Accessor = PreallocatedMemoryBufferStream::Accessor;
 
-    static inline auto build(size_t s) {
-        return PreallocatedMemoryBufferStreamWriter(s); 
+    /**
+     * Pool to draw buffers from, heap is used directly if null.
+     */
+    BufferPool* pool = nullptr;
+
+    inline auto build(size_t s) const {
+        return PreallocatedMemoryBufferStreamWriter(s, pool); 
+    }
+
+    static constexpr size_t inlineCapacity = InlineMemoryBufferStreamWriter::capacity;
+
+    static inline auto buildInline() {
+        return InlineMemoryBufferStreamWriter();
+    }
+
+    static inline auto done(InlineMemoryBufferStreamWriter &&w) {
+        return w.finish();
     }
 
     static inline auto done(PreallocatedMemoryBufferStreamWriter &&w) 
@@ -108,54 +402,773 @@ struct PreallocatedMemoryBufferStreamWriterFactory
     }
 };
 
-class FdStreamAdapter
+/**
+ * Message writer that enlarges its buffer as needed.
+ *
+ * Used when the size of the message is not determined before serializing it.
+ * Space for the longest possible frame header is reserved at the beginning of
+ * the buffer, the actual header is written right before the payload when the
+ * message is complete, the frame starts where the header begins.
+ *
+ * Large blocks can be included by reference (see ArrayReference), those are
+ * written out from the memory of the caller by the send queue (using vectored
+ * writes). The referenced memory must stay valid and unchanged until the message
+ * is completely written, which is when the pendingOutput method of the adapter
+ * returns zero (for FdStreamAdapter it is the case after the send call with the
+ * immediate policy on a blocking descriptor or a flush call returned, EpollStreamAdapter
+ * can also notify about it via the callback set using setDrainedCallback).
+ */
+class GrowableMemoryBufferStreamWriter
 {
-    int wfd = -1, rfd = -1;
+    friend GrowableMemoryBufferStreamWriterFactory;
+
+    static constexpr size_t headerSpace = 5;
+
+    /**
+     * Blocks smaller than this are copied even if requested to be referenced.
+     */
+    static constexpr size_t minReferenceSize = 1024;
+
+    BufferPool* pool;
+    BufferPool::Buffer buffer;
+    char *ptr, *end;
+
+    std::vector<PreallocatedMemoryBufferStream::Reference> references;
+    size_t referencedBytes = 0;
+
+    inline GrowableMemoryBufferStreamWriter(size_t initialSize, BufferPool* pool):
+        pool(pool), buffer(BufferPool::allocate(pool, headerSpace + initialSize)),
+        ptr(buffer.get() + headerSpace), end(buffer.get() + headerSpace + initialSize) {}
+
+    /**
+     * Make room for at least _size_ more bytes, at least doubling the size of the buffer.
+     */
+    inline void reserve(size_t size)
+    {
+        if(size_t(end - ptr) < size)
+        {
+            const size_t used = ptr - buffer.get(), capacity = end - buffer.get();
+            const auto newCapacity = used + size < 2 * capacity ? 2 * capacity : used + size;
+
+            auto b = BufferPool::allocate(pool, newCapacity);
+            memcpy(b.get(), buffer.get(), used);
+            buffer = std::move(b);
+            ptr = buffer.get() + used;
+            end = buffer.get() + newCapacity;
+        }
+    }
 
 public:
-    using InputAccessor = PreallocatedMemoryBufferStream::Accessor;
+    template<class T>
+    bool write(const T& v)
+    {
+        reserve(sizeof(T));
+        memcpy(ptr, &v, sizeof(T));
+        ptr += sizeof(T);
+        return true;
+    }
 
-    FdStreamAdapter(const FdStreamAdapter&) = delete;
-    inline FdStreamAdapter(int wfd, int rfd): wfd(wfd), rfd(rfd) {}
+    bool writePrefix(uint64_t word, size_t size)
+    {
+        reserve(sizeof(word));
+        memcpy(ptr, &word, sizeof(word));
+        ptr += size;
+        return true;
+    }
+
+    bool writeBlock(const void* data, size_t size)
+    {
+        reserve(size);
+        memcpy(ptr, data, size);
+        ptr += size;
+        return true;
+    }
+
+    bool writeReference(const void* data, size_t size)
+    {
+        if(size < minReferenceSize)
+        {
+            return writeBlock(data, size);
+        }
+
+        references.push_back({size_t(ptr - (buffer.get() + headerSpace)), static_cast<const char*>(data), size});
+        referencedBytes += size;
+        return true;
+    }
+};
+
+/**
+ * Message factory that does not need the size of the message in advance.
+ *
+ * The endpoint skips determining the size of the arguments (which needs
+ * an extra pass over all the elements of variable sized collections) if
+ * the factory can build messages without it.
+ */
+struct GrowableMemoryBufferStreamWriterFactory
+{
+    /**
+     * Pool to draw buffers from, heap is used directly if null.
+     */
+    BufferPool* pool = nullptr;
+
+    /**
+     * Initial payload capacity of the messages.
+     */
+    size_t initialSize = 256;
+
+    inline auto build() const {
+        return GrowableMemoryBufferStreamWriter(initialSize, pool);
+    }
+
+    static constexpr size_t inlineCapacity = InlineMemoryBufferStreamWriter::capacity;
+
+    static inline auto buildInline() {
+        return InlineMemoryBufferStreamWriter();
+    }
+
+    static inline auto done(InlineMemoryBufferStreamWriter &&w) {
+        return w.finish();
+    }
+
+    static inline auto done(GrowableMemoryBufferStreamWriter &&w)
+    {
+        const auto payloadStart = w.buffer.get() + GrowableMemoryBufferStreamWriter::headerSpace;
+        const size_t payload = (w.ptr - payloadStart) + w.referencedBytes;
+        const auto total = PreallocatedMemoryBufferStream::frameLength(payload);
+        assert(total == (size_t)((uint32_t)total));
+
+        const auto frame = payloadStart - (total - payload);
+        PreallocatedMemoryBufferStream::Accessor a(frame, payloadStart);
+        auto lengthWriteOk = VarUint4::write(a, (uint32_t)total);
+        assert(lengthWriteOk);
+
+        PreallocatedMemoryBufferStream ret(std::move(w.buffer), 0);
+        ret.start = payloadStart;
+        ret.end = w.ptr;
+        ret.frame = frame;
+        ret.references = std::move(w.references);
+        return ret;
+    }
+};
+
+/**
+ * Adapter extension that builds outgoing messages without determining their size first.
+ *
+ * Can be applied to FdStreamAdapter or EpollStreamAdapter (for example StlEndpoint<WithGrowableMessages<FdStreamAdapter>>),
+ * it is worth using if the arguments are mostly deeply nested variable sized collections.
+ */
+template<class Io>
+struct WithGrowableMessages: Io
+{
+    using Io::Io;
 
     inline auto messageFactory() {
-    	return PreallocatedMemoryBufferStreamWriterFactory{};
+        return GrowableMemoryBufferStreamWriterFactory{Io::messageFactory().pool};
     }
+};
 
-    bool send(PreallocatedMemoryBufferStream&& data)
+/**
+ * Chunked input buffer for a byte stream of length prefixed frames.
+ *
+ * Data is read from the stream in large chunks, then all the complete frames
+ * found in it are handed out as non-owning views into the buffer, so there is
+ * no system call or allocation needed per message.
+ */
+class ReceiveBuffer
+{
+    /**
+     * Minimal capacity, enough to hold any frame header.
+     */
+    static constexpr size_t minCapacity = 16;
+
+    std::unique_ptr<char[]> data;
+    size_t capacity = 0, start = 0, end = 0;
+
+    /**
+     * Full length of the frame at the start of the buffered data if it
+     * is not complete yet, zero if unknown.
+     */
+    size_t pending = 0;
+
+    size_t maxFrameLength = PreallocatedMemoryBufferStream::defaultMaxFrameLength;
+
+    inline void grow(size_t newCapacity)
+    {
+        std::unique_ptr<char[]> newData(new char[newCapacity]);
+        memcpy(newData.get(), data.get() + start, end - start);
+        data = std::move(newData);
+        capacity = newCapacity;
+        end -= start;
+        start = 0;
+    }
+
+public:
+    inline ReceiveBuffer() = default;
+
+    /**
+     * Set the size of the buffer, zero disables buffering.
+     *
+     * NOTE: must not be called while there is data buffered.
+     */
+    inline void resize(size_t size)
+    {
+        assert(start == end);
+        capacity = (size && size < minCapacity) ? minCapacity : size;
+        data.reset(capacity ? new char[capacity] : nullptr);
+        start = end = pending = 0;
+    }
+
+    inline bool isEnabled() const {
+        return capacity != 0;
+    }
+
+    /**
+     * Set the limit of the length of frames, longer ones make dispatch fail.
+     */
+    inline void setMaxFrameLength(size_t length) {
+        maxFrameLength = length;
+    }
+
+    /**
+     * Get the free space after the buffered data.
+     *
+     * Moves the buffered data to the beginning or grows the buffer
+     * if needed to fit the next complete frame.
+     */
+    inline char* freeSpace(size_t &length)
     {
-        auto ptr = data.buffer.get();
-        auto len = data.end - ptr;
-        return write(wfd, ptr, len) == len;
+        if(start == end)
+        {
+            start = end = 0;
+        }
+        else if(start && (end == capacity || capacity - start < pending))
+        {
+            memmove(data.get(), data.get() + start, end - start);
+            end -= start;
+            start = 0;
+        }
+
+        if(capacity < pending)
+        {
+            grow(pending);
+        }
+
+        length = capacity - end;
+        return data.get() + end;
+    }
+
+    /**
+     * Account for data written into the free space.
+     */
+    inline void commit(size_t length) {
+        end += length;
     }
 
+    /**
+     * Pass all complete frames to the callback, stops if the callback returns false.
+     *
+     * The message passed to the callback is only valid during its execution.
+     * Returns false if the callback failed or an invalid frame header was
+     * found, the number of processed frames is stored via the count argument.
+     */
     template<class C>
-    bool receive(C&& cb)
+    inline bool dispatch(C&& cb, size_t &count)
     {
-        uint32_t messageLength;
+        count = 0;
+
+        while(true)
+        {
+            VarUint4::Reader r;
+            auto ptr = data.get() + start;
+            const auto dataEnd = data.get() + end;
+
+            while(true)
+            {
+                if(ptr == dataEnd)
+                {
+                    pending = 0;
+                    return true;
+                }
+
+                if(r.process(*ptr++))
+                {
+                    break;
+                }
+            }
+
+            size_t messageLength;
+
+            if(!PreallocatedMemoryBufferStream::payloadLength(r.getResult(), maxFrameLength, messageLength))
+            {
+                return false;
+            }
+
+            if(size_t(dataEnd - ptr) < messageLength)
+            {
+                pending = (ptr - data.get()) - start + messageLength;
+                return true;
+            }
+
+            start = (ptr - data.get()) + messageLength;
+            count++;
+
+            if(!cb(PreallocatedMemoryBufferStream(ptr, ptr + messageLength)))
+            {
+                return false;
+            }
+        }
+    }
+};
+
+/**
+ * Output queue that coalesces outgoing messages into vectored writes.
+ *
+ * Messages are kept until they are completely written, partial writes
+ * are continued from where they stopped on the next attempt.
+ */
+class SendQueue
+{
+    /**
+     * Maximal number of messages written by a single system call.
+     */
+    static constexpr size_t batchSize = 64;
+
+    std::vector<PreallocatedMemoryBufferStream> messages;
+
+    /**
+     * Index of the first message not yet written completely.
+     */
+    size_t head = 0;
+
+    /**
+     * Number of bytes of the head message already written.
+     */
+    size_t offset = 0;
+
+    /**
+     * Number of bytes waiting to be written.
+     */
+    size_t queued = 0;
+
+    inline void consume(size_t written)
+    {
+        queued -= written;
+
+        while(written)
+        {
+            auto &m = messages[head];
+            const size_t rest = m.frameSize() - offset;
+
+            if(written < rest)
+            {
+                offset += written;
+                break;
+            }
+
+            written -= rest;
+            offset = 0;
+            head++;
+        }
+
+        if(head == messages.size())
+        {
+            messages.clear();
+            head = 0;
+        }
+    }
+
+public:
+    inline void push(PreallocatedMemoryBufferStream&& data)
+    {
+        queued += data.frameSize();
+        messages.push_back(std::move(data));
+    }
+
+    inline size_t size() const {
+        return queued;
+    }
+
+    inline bool empty() const {
+        return head == messages.size();
+    }
+
+    /**
+     * Outcome of an attempt to write out the queue.
+     */
+    enum class WriteResult
+    {
+        done,       //!< All of the queued data has been written.
+        wouldBlock, //!< The (non-blocking) descriptor can not take more data, the rest is left in the queue.
+        failed      //!< Write error (including a write that makes no progress).
+    };
+
+    /**
+     * Write as much of the queued data as possible to the file descriptor.
+     *
+     * If the descriptor can not take more data, then the messages already written
+     * are dropped and the caller is expected to wait for it to become writable.
+     */
+    inline WriteResult writeTo(int fd)
+    {
+        while(!empty())
+        {
+            struct iovec iov[batchSize];
+            int n = 0;
+
+            for(auto i = head; i < messages.size() && n < (int)batchSize; i++)
+            {
+                size_t skip = (i == head) ? offset : 0;
+
+                messages[i].forEachPiece([&](const char* p, size_t length)
+                {
+                    if(skip >= length)
+                    {
+                        skip -= length;
+                    }
+                    else if(n < (int)batchSize)
+                    {
+                        iov[n].iov_base = const_cast<char*>(p) + skip;
+                        iov[n].iov_len = length - skip;
+                        skip = 0;
+                        n++;
+                    }
+                });
+            }
+
+            auto r = writev(fd, iov, n);
+
+            if(r <= 0)
+            {
+                if(r < 0 && errno == EINTR)
+                    continue;
+
+                if(r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    messages.erase(messages.begin(), messages.begin() + head);
+                    head = 0;
+                    return WriteResult::wouldBlock;
+                }
+
+                return WriteResult::failed;
+            }
+
+            consume(r);
+        }
+
+        return WriteResult::done;
+    }
+};
+
+class FdStreamAdapter
+{
+public:
+    /**
+     * Strategy for writing out the messages sent.
+     */
+    enum class FlushPolicy
+    {
+        immediate,     //!< Write each message as soon as it is sent (default).
+        sizeThreshold, //!< Write when the amount of queued data reaches a threshold.
+        explicitFlush, //!< Write only when flush is called.
+        afterReceive   //!< Messages sent by the receiving thread while processing received ones are written at the end of the receive call.
+    };
+
+private:
+    int wfd = -1, rfd = -1;
+
+    BufferPool ownPool;
+    BufferPool* pool = &ownPool;
+
+    ReceiveBuffer rxBuffer;
+    size_t maxFrameLength = PreallocatedMemoryBufferStream::defaultMaxFrameLength;
+
+    SendQueue txQueue;
+    std::mutex txLock;
+    FlushPolicy flushPolicy = FlushPolicy::immediate;
+    size_t flushThreshold = 0;
+
+    /**
+     * The thread processing received messages (with the afterReceive policy).
+     *
+     * Only the messages it sends are held back, sending from other threads is
+     * not delayed, so those can not hold the lock while the receiver waits for it.
+     */
+    std::atomic<std::thread::id> receiver;
+    bool deferred = false;
+
+    /**
+     * Wait until a non-blocking descriptor becomes ready for the specified events.
+     */
+    static inline bool waitFor(int fd, short events)
+    {
+        struct pollfd p = {fd, events, 0};
+
+        while(true)
+        {
+            const auto r = poll(&p, 1, -1);
+
+            if(r > 0)
+                return true;
+
+            if(r < 0 && errno != EINTR)
+                return false;
+        }
+    }
+
+    /**
+     * Write out the whole queue, waiting for the descriptor to become writable if needed.
+     */
+    inline bool flushQueue()
+    {
+        while(true)
+        {
+            switch(txQueue.writeTo(wfd))
+            {
+            case SendQueue::WriteResult::done:
+                return true;
+            case SendQueue::WriteResult::wouldBlock:
+                if(!waitFor(wfd, POLLOUT))
+                    return false;
+
+                break;
+            default:
+                return false;
+            }
+        }
+    }
+
+    /**
+     * Read exactly the specified number of bytes, fails on error or end of stream.
+     */
+    inline bool readFully(char* ptr, size_t length)
+    {
+        while(length)
+        {
+            const auto r = read(rfd, ptr, length);
+
+            if(r > 0)
+            {
+                ptr += r;
+                length -= r;
+                continue;
+            }
+
+            if(r < 0 && errno == EINTR)
+                continue;
+
+            if(r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && waitFor(rfd, POLLIN))
+                continue;
+
+            return false;
+        }
+
+        return true;
+    }
+
+    template<class C>
+    bool receiveSingle(C&& cb)
+    {
+        size_t messageLength;
         VarUint4::Reader r;
 
         while(true)
         {
             char c;
-            if(read(rfd, &c, 1) != 1)
+            if(!readFully(&c, 1))
                 return false;
 
             if(r.process(c))
             {
-                auto result = r.getResult();
-                messageLength = result - VarUint4::size((uint32_t)result);
+                if(!PreallocatedMemoryBufferStream::payloadLength(r.getResult(), maxFrameLength, messageLength))
+                    return false;
+
                 break;
             }
         }
 
-        std::unique_ptr<char[]> buffer(new char[messageLength]);
+        auto buffer = BufferPool::allocate(pool, messageLength);
 
-        if(read(rfd, buffer.get(), messageLength) != messageLength)
+        if(!readFully(buffer.get(), messageLength))
             return false;
 
         return cb(PreallocatedMemoryBufferStream(std::move(buffer), messageLength));
     }
+
+    template<class C>
+    bool receiveBuffered(C&& cb)
+    {
+        while(true)
+        {
+            size_t count;
+
+            if(!rxBuffer.dispatch(cb, count))
+                return false;
+
+            if(count)
+                return true;
+
+            size_t length;
+            auto ptr = rxBuffer.freeSpace(length);
+            auto r = read(rfd, ptr, length);
+
+            if(r <= 0)
+            {
+                if(r < 0 && errno == EINTR)
+                    continue;
+
+                return false;
+            }
+
+            rxBuffer.commit(r);
+        }
+    }
+
+public:
+    using InputAccessor = PreallocatedMemoryBufferStream::Accessor;
+
+    FdStreamAdapter(const FdStreamAdapter&) = delete;
+    inline FdStreamAdapter(int wfd, int rfd): wfd(wfd), rfd(rfd) {}
+
+    /**
+     * Enable buffered, batched receive mode with the specified buffer size, zero disables it.
+     *
+     * In buffered mode data is read in large chunks and each receive call handles
+     * all the messages that are available at once, without copying them. Messages
+     * larger than the buffer make it grow as needed.
+     */
+    inline void setReceiveBufferSize(size_t size) {
+        rxBuffer.resize(size);
+    }
+
+    /**
+     * Set the limit of the length of received frames (64MiB by default).
+     *
+     * A longer frame (or an invalid frame header) makes the receive call fail,
+     * so a peer can not make the adapter allocate arbitrary amounts of memory.
+     */
+    inline void setMaxFrameLength(size_t length)
+    {
+        maxFrameLength = length;
+        rxBuffer.setMaxFrameLength(length);
+    }
+
+    /**
+     * Draw message buffers from an external pool instead of the adapter's own one.
+     *
+     * A null value disables pooling. The pool must outlive the adapter and
+     * all the messages it received.
+     *
+     * NOTE: must not be called while there are sent messages queued.
+     */
+    inline void setBufferPool(BufferPool* pool) {
+        this->pool = pool;
+    }
+
+    /**
+     * Get the allocation counters of the pool used.
+     */
+    inline auto getBufferPoolStatistics() {
+        return pool ? pool->getStatistics() : BufferPool::Statistics{};
+    }
+
+    inline auto messageFactory() {
+    	return PreallocatedMemoryBufferStreamWriterFactory{pool};
+    }
+
+    /**
+     * Set the strategy of writing out sent messages.
+     *
+     * The threshold is the amount of queued data that triggers writing
+     * it out, it is only used with the sizeThreshold policy.
+     *
+     * NOTE: messages left in the queue when the adapter is destroyed are lost.
+     */
+    inline void setFlushPolicy(FlushPolicy policy, size_t threshold = 0)
+    {
+        std::lock_guard _(txLock);
+        flushPolicy = policy;
+        flushThreshold = threshold;
+    }
+
+    /**
+     * Write out all the queued messages.
+     */
+    inline bool flush()
+    {
+        std::lock_guard _(txLock);
+        return flushQueue();
+    }
+
+    /**
+     * Get the number of bytes sent but not written out yet.
+     *
+     * Memory referenced by sent messages (see ArrayReference) can be reused
+     * once it returns zero.
+     */
+    inline size_t pendingOutput()
+    {
+        std::lock_guard _(txLock);
+        return txQueue.size();
+    }
+
+    bool send(PreallocatedMemoryBufferStream&& data)
+    {
+        std::lock_guard _(txLock);
+        txQueue.push(std::move(data));
+
+        switch(flushPolicy)
+        {
+        case FlushPolicy::sizeThreshold:
+            return txQueue.size() < flushThreshold || flushQueue();
+        case FlushPolicy::explicitFlush:
+            return true;
+        case FlushPolicy::afterReceive:
+            if(receiver.load() == std::this_thread::get_id())
+            {
+                deferred = true;
+                return true;
+            }
+
+            return flushQueue();
+        default:
+            return flushQueue();
+        }
+    }
+
+    /**
+     * Receive and process incoming message(s).
+     *
+     * Returns false on IO error or if the callback returned false.
+     */
+    template<class C>
+    bool receive(C&& cb)
+    {
+        auto process = [this, &cb](PreallocatedMemoryBufferStream&& s)
+        {
+            if(flushPolicy == FlushPolicy::afterReceive)
+                receiver = std::this_thread::get_id();
+
+            return cb(std::move(s));
+        };
+
+        bool ok = rxBuffer.isEnabled() ? receiveBuffered(process) : receiveSingle(process);
+
+        if(receiver.load() == std::this_thread::get_id())
+        {
+            receiver = std::thread::id();
+
+            if(deferred)
+            {
+                std::lock_guard _(txLock);
+                deferred = false;
+
+                if(!flushQueue())
+                    return false;
+            }
+        }
+
+        return ok;
+    }
 };
 
 }
@@ -0,0 +1,152 @@
+#ifndef _RPCINLINEPOINTER_H_
+#define _RPCINLINEPOINTER_H_
+
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include <cstddef>
+
+namespace rpc {
+
+namespace detail {
+
+/**
+ * Owning polymorphic pointer with small buffer optimization.
+ *
+ * Objects that fit in the internal buffer are constructed in place, so storing
+ * the pointer in a registry keeps small invokers (with a few captured values)
+ * in the table slot itself, without a heap allocation per registration. Bigger
+ * objects are allocated on the heap, like with StlAutoPointer.
+ *
+ * The contained object needs to be move constructible, it is relocated (moved
+ * and destroyed) when the pointer itself is moved.
+ */
+template<class T, size_t inlineSize>
+class BasicInlinePointer
+{
+    using Relocator = T* (*)(void* dst, void* src);
+
+    alignas(std::max_align_t) char storage[inlineSize];
+    T* ptr = nullptr;
+
+    /**
+     * Null for heap allocated objects.
+     */
+    Relocator relocator = nullptr;
+
+    template<class U>
+    static T* relocate(void* dst, void* src)
+    {
+        auto s = static_cast<U*>(src);
+        auto ret = new(dst) U(std::move(*s));
+        s->~U();
+        return ret;
+    }
+
+    inline void reset()
+    {
+        if(relocator)
+        {
+            ptr->~T();
+        }
+        else
+        {
+            delete ptr;
+        }
+
+        ptr = nullptr;
+        relocator = nullptr;
+    }
+
+    inline void take(BasicInlinePointer& o)
+    {
+        if(o.relocator)
+        {
+            ptr = o.relocator(storage, o.storage);
+            relocator = o.relocator;
+        }
+        else
+        {
+            ptr = o.ptr;
+        }
+
+        o.ptr = nullptr;
+        o.relocator = nullptr;
+    }
+
+    inline BasicInlinePointer() = default;
+
+public:
+    template<class U>
+    static constexpr bool fitsInline = sizeof(U) <= inlineSize && alignof(U) <= alignof(std::max_align_t);
+
+    template<class U, class... Args>
+    static inline BasicInlinePointer make(Args&&... args)
+    {
+        BasicInlinePointer ret;
+
+        if constexpr(fitsInline<U>)
+        {
+            ret.ptr = new(ret.storage) U(std::forward<Args>(args)...);
+            ret.relocator = &relocate<U>;
+        }
+        else
+        {
+            ret.ptr = new U(std::forward<Args>(args)...);
+        }
+
+        return ret;
+    }
+
+    inline BasicInlinePointer(BasicInlinePointer&& o) {
+        take(o);
+    }
+
+    inline BasicInlinePointer& operator=(BasicInlinePointer&& o)
+    {
+        if(this != &o)
+        {
+            reset();
+            take(o);
+        }
+
+        return *this;
+    }
+
+    inline ~BasicInlinePointer()
+    {
+        if(ptr)
+        {
+            reset();
+        }
+    }
+
+    inline T* get() const {
+        return ptr;
+    }
+
+    inline T* operator->() const {
+        return ptr;
+    }
+
+    inline T& operator*() const {
+        return *ptr;
+    }
+
+    inline explicit operator bool() const {
+        return ptr != nullptr;
+    }
+};
+
+/**
+ * Inline pointer with a buffer that, together with the bookkeeping, fills a cache line.
+ */
+template<class T>
+using InlinePointer = BasicInlinePointer<T, 48>;
+
+}
+
+}
+
+#endif /* _RPCINLINEPOINTER_H_ */
@@ -0,0 +1,345 @@
+#ifndef _RPCPAGEDREGISTRY_H_
+#define _RPCPAGEDREGISTRY_H_
+
+#include "StlAdapters.h"
+#include "ConcurrentRegistry.h"
+
+#include <algorithm>
+#include <new>
+#include <type_traits>
+
+namespace rpc {
+
+namespace detail {
+
+/**
+ * Registry for small integer keys, implemented as a paged direct-index array.
+ *
+ * Call identifiers are handed out cyclically from a window that is kept at
+ * about twice the number of live registrations, with a small generation tag in
+ * the lowest bits, so the live ones are small and mostly dense. The key is split into three parts that index the
+ * page directory, a group of pages and a slot in a page, so a lookup is three
+ * dependent loads and a bit test, without hashing. Pages and groups that become
+ * empty are freed and the directory is trimmed, so the memory usage follows the
+ * set of live entries, even with constant churn of short lived callbacks. The last
+ * freed page and group are kept for reuse, so that a single callback being installed
+ * and removed repeatedly does not allocate from the heap every time.
+ *
+ * Lookups do not take the lock: the directory, the groups and the pages are
+ * published with release stores and read with acquire loads, only modifications
+ * are serialized by the mutex. A lookup may still hold a page or group that was
+ * unlinked concurrently, so those (and the replaced directories) are freed only
+ * after the lookups in progress are finished (see ReaderSlots), outside the lock.
+ * The spare page and group can be reused right away, because every page records
+ * the range of keys it currently serves, which is checked by the lookup.
+ *
+ * With the NullMutex (for endpoints owned by a single thread) there are no
+ * concurrent lookups, so memory is freed immediately.
+ */
+template<class K, class V, class Mutex>
+class BasicPagedArrayRegistry
+{
+    static_assert(std::is_unsigned_v<K> && sizeof(K) <= sizeof(uint32_t), "keys need to be at most 32 bit unsigned integers");
+
+    static constexpr size_t pageBits = 6, groupBits = 6;
+    static constexpr size_t pageSize = size_t(1) << pageBits, groupSize = size_t(1) << groupBits;
+    static constexpr bool concurrent = !std::is_same_v<Mutex, NullMutex>;
+
+    struct Page
+    {
+        std::atomic<uint64_t> used = {0};
+        std::atomic<size_t> base = {0};
+        alignas(V) char storage[pageSize * sizeof(V)];
+
+        inline V* at(size_t idx) {
+            return std::launder(reinterpret_cast<V*>(storage) + idx);
+        }
+
+        inline ~Page()
+        {
+            const auto live = used.load(std::memory_order_relaxed);
+
+            for(size_t i = 0; i < pageSize; i++)
+            {
+                if(live >> i & 1)
+                {
+                    at(i)->~V();
+                }
+            }
+        }
+    };
+
+    struct Group
+    {
+        std::atomic<Page*> pages[groupSize] = {};
+        size_t count = 0;
+
+        inline ~Group()
+        {
+            for(auto& p: pages)
+            {
+                delete p.load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Directory
+    {
+        const size_t capacity;
+        std::unique_ptr<std::atomic<Group*>[]> groups;
+
+        inline Directory(size_t capacity): capacity(capacity), groups(new std::atomic<Group*>[capacity])
+        {
+            for(size_t i = 0; i < capacity; i++)
+            {
+                groups[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    /**
+     * Memory unlinked by a modification, to be freed once the concurrent lookups are done.
+     */
+    struct Retired
+    {
+        Directory* directory = nullptr;
+        Group* group = nullptr;
+        Page* page = nullptr;
+
+        inline ~Retired()
+        {
+            if(directory || group || page)
+            {
+                if constexpr(concurrent)
+                {
+                    ReaderSlots::synchronize();
+                }
+
+                delete directory;
+                delete group;
+                delete page;
+            }
+        }
+    };
+
+    std::atomic<Directory*> directory = {nullptr};
+    size_t directoryLength = 0;
+    Page* sparePage = nullptr;
+    Group* spareGroup = nullptr;
+    Mutex mut;
+
+    static inline size_t groupIndex(size_t k) {
+        return k >> (pageBits + groupBits);
+    }
+
+    static inline size_t pageIndex(size_t k) {
+        return (k >> pageBits) & (groupSize - 1);
+    }
+
+    static inline size_t slotIndex(size_t k) {
+        return k & (pageSize - 1);
+    }
+
+    static inline size_t pageBase(size_t k) {
+        return k >> pageBits;
+    }
+
+    /**
+     * Replace the directory with one of the specified capacity, keeping the first directoryLength groups.
+     */
+    inline void reallocate(Directory* old, size_t capacity, Retired& retired)
+    {
+        auto d = new Directory(capacity);
+
+        for(size_t i = 0; i < directoryLength; i++)
+        {
+            d->groups[i].store(old->groups[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+
+        directory.store(d, std::memory_order_release);
+        retired.directory = old;
+    }
+
+public:
+    BasicPagedArrayRegistry() = default;
+    BasicPagedArrayRegistry(const BasicPagedArrayRegistry&) = delete;
+    BasicPagedArrayRegistry& operator=(const BasicPagedArrayRegistry&) = delete;
+
+    inline ~BasicPagedArrayRegistry()
+    {
+        if(auto d = directory.load(std::memory_order_relaxed))
+        {
+            for(size_t i = 0; i < directoryLength; i++)
+            {
+                delete d->groups[i].load(std::memory_order_relaxed);
+            }
+
+            delete d;
+        }
+
+        delete sparePage;
+        delete spareGroup;
+    }
+
+    inline bool remove(const K& k)
+    {
+        Retired retired;
+        std::lock_guard _(mut);
+
+        const auto d = directory.load(std::memory_order_relaxed);
+        const auto g = groupIndex(k);
+        const auto group = g < directoryLength ? d->groups[g].load(std::memory_order_relaxed) : nullptr;
+        const auto p = group ? group->pages[pageIndex(k)].load(std::memory_order_relaxed) : nullptr;
+        const auto idx = slotIndex(k);
+        const auto used = p ? p->used.load(std::memory_order_relaxed) : 0;
+
+        if(!(used >> idx & 1))
+            return false;
+
+        p->used.store(used & ~(uint64_t(1) << idx), std::memory_order_release);
+        p->at(idx)->~V();
+
+        if(used == uint64_t(1) << idx)
+        {
+            group->pages[pageIndex(k)].store(nullptr, std::memory_order_release);
+            retired.page = sparePage;
+            sparePage = p;
+
+            if(!--group->count)
+            {
+                d->groups[g].store(nullptr, std::memory_order_release);
+                retired.group = spareGroup;
+                spareGroup = group;
+
+                while(directoryLength && !d->groups[directoryLength - 1].load(std::memory_order_relaxed))
+                {
+                    directoryLength--;
+                }
+
+                if(directoryLength < d->capacity / 4)
+                {
+                    reallocate(d, directoryLength, retired);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    inline bool add(const K& k, V&& v)
+    {
+        Retired retired;
+        std::lock_guard _(mut);
+
+        auto d = directory.load(std::memory_order_relaxed);
+        const auto g = groupIndex(k);
+
+        if(!d || d->capacity <= g)
+        {
+            reallocate(d, std::max(g + 1, d ? 2 * d->capacity : 0), retired);
+            d = directory.load(std::memory_order_relaxed);
+        }
+
+        if(directoryLength <= g)
+        {
+            directoryLength = g + 1;
+        }
+
+        auto group = d->groups[g].load(std::memory_order_relaxed);
+
+        if(!group)
+        {
+            group = spareGroup ? spareGroup : new Group;
+            spareGroup = nullptr;
+            d->groups[g].store(group, std::memory_order_release);
+        }
+
+        auto p = group->pages[pageIndex(k)].load(std::memory_order_relaxed);
+
+        if(!p)
+        {
+            p = sparePage ? sparePage : new Page;
+            sparePage = nullptr;
+            p->base.store(pageBase(k), std::memory_order_relaxed);
+            group->pages[pageIndex(k)].store(p, std::memory_order_release);
+            group->count++;
+        }
+
+        const auto idx = slotIndex(k);
+        const auto used = p->used.load(std::memory_order_relaxed);
+
+        if(used >> idx & 1)
+            return false;
+
+        new(p->storage + idx * sizeof(V)) V(std::move(v));
+        p->used.store(used | uint64_t(1) << idx, std::memory_order_release);
+        return true;
+    }
+
+    inline V* find(const K& k, bool &ok)
+    {
+        uint64_t seq;
+
+        if constexpr(concurrent)
+        {
+            seq = ReaderSlots::enter();
+        }
+
+        V* ret = nullptr;
+        const auto g = groupIndex(k);
+
+        if(auto d = directory.load(std::memory_order_acquire); d && g < d->capacity)
+        {
+            if(auto group = d->groups[g].load(std::memory_order_acquire))
+            {
+                if(auto p = group->pages[pageIndex(k)].load(std::memory_order_acquire))
+                {
+                    const auto idx = slotIndex(k);
+
+                    /*
+                     * The key range is checked after the bit, as a page that was
+                     * reused for another range gets its new base before any bits set.
+                     */
+                    if((p->used.load(std::memory_order_acquire) >> idx & 1) && p->base.load(std::memory_order_relaxed) == pageBase(k))
+                    {
+                        ret = p->at(idx);
+                    }
+                }
+            }
+        }
+
+        if constexpr(concurrent)
+        {
+            ReaderSlots::leave(seq);
+        }
+
+        ok = ret != nullptr;
+        return ret;
+    }
+};
+
+/**
+ * Uses the paged array for call identifiers and falls back to hashing for other
+ * keys (i.e. the symbol hashes that are sparse by nature).
+ */
+template<class K, class V, class Mutex>
+using BasicPagedRegistry = std::conditional_t<
+    std::is_unsigned_v<K> && sizeof(K) <= sizeof(uint32_t),
+    BasicPagedArrayRegistry<K, V, Mutex>,
+    BasicHashMapRegistry<K, V, Mutex>
+>;
+
+template<class K, class V>
+using PagedRegistry = BasicPagedRegistry<K, V, std::mutex>;
+
+/**
+ * Paged registry without locking, for endpoints that are owned by a single thread.
+ */
+template<class K, class V>
+using UnsyncedPagedRegistry = BasicPagedRegistry<K, V, NullMutex>;
+
+}
+
+}
+
+#endif /* _RPCPAGEDREGISTRY_H_ */
@@ -0,0 +1,120 @@
+#ifndef _RPCREACTORPOOL_H_
+#define _RPCREACTORPOOL_H_
+
+#include "EpollReactor.h"
+
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace rpc {
+
+/**
+ * Set of event loops each running on its own thread, optionally pinned to a core.
+ *
+ * Connections are sharded across the reactors, every endpoint is owned by the
+ * thread of the reactor it was set up on and must only be accessed from there,
+ * so endpoints can use a registry without locking (detail::UnsyncedHashMapRegistry).
+ * Work can be handed over to another shard by posting a job to its reactor.
+ */
+class ReactorPool
+{
+    std::vector<std::unique_ptr<EpollReactor>> reactors;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextShard = 0;
+
+    static inline void pin(std::thread& t, size_t idx)
+    {
+        const auto nCores = std::thread::hardware_concurrency();
+
+        if(nCores)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(idx % nCores, &set);
+            pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+        }
+    }
+
+public:
+    /**
+     * Start the specified number of reactor threads (one per core by default).
+     */
+    inline ReactorPool(size_t n = std::thread::hardware_concurrency(), bool pinned = true)
+    {
+        if(!n)
+        {
+            n = 1;
+        }
+
+        for(size_t i = 0; i < n; i++)
+        {
+            reactors.emplace_back(new EpollReactor);
+        }
+
+        for(size_t i = 0; i < n; i++)
+        {
+            threads.emplace_back([r{reactors[i].get()}](){ r->run(); });
+
+            if(pinned)
+            {
+                pin(threads.back(), i);
+            }
+        }
+    }
+
+    ReactorPool(const ReactorPool&) = delete;
+    ReactorPool& operator=(const ReactorPool&) = delete;
+
+    /**
+     * Stop and join all the reactor threads.
+     *
+     * NOTE: endpoints attached to the reactors must be destroyed before.
+     */
+    inline ~ReactorPool()
+    {
+        for(auto& r: reactors)
+        {
+            r->stop();
+        }
+
+        for(auto& t: threads)
+        {
+            t.join();
+        }
+    }
+
+    inline size_t size() const {
+        return reactors.size();
+    }
+
+    inline EpollReactor& shard(size_t idx) {
+        return *reactors[idx];
+    }
+
+    /**
+     * Execute a job on the thread of the specified shard.
+     */
+    template<class C>
+    inline void post(size_t idx, C&& job) {
+        reactors[idx]->post(std::forward<C>(job));
+    }
+
+    /**
+     * Assign a new connection to a shard in a round-robin fashion.
+     *
+     * The setup functor is called on the thread of the selected shard with the
+     * reactor and the descriptor, it is expected to create an endpoint for it.
+     */
+    template<class C>
+    inline void distribute(int fd, C&& setup)
+    {
+        auto& r = *reactors[nextShard++ % reactors.size()];
+        r.post([&r, fd, setup{std::forward<C>(setup)}]() mutable { setup(r, fd); });
+    }
+};
+
+}
+
+#endif /* _RPCREACTORPOOL_H_ */
@@ -6,6 +6,7 @@
 #include "base/RpcEndpoint.h"
 
 #include "types/StdStringTypeInfo.h"
+#include "types/StdStringViewTypeInfo.h"
 #include "types/StdVectorTypeInfo.h"
 
 #include <memory>
@@ -30,11 +31,20 @@ template<class C> struct CollectionSelector<C, void> {
 
 namespace detail
 {
-    template<class K, class V>
-    class HashMapRegistry
+    /**
+     * Stand-in for std::mutex for objects that are only ever used from a single thread.
+     */
+    struct NullMutex
+    {
+        inline void lock() {}
+        inline void unlock() {}
+    };
+
+    template<class K, class V, class Mutex>
+    class BasicHashMapRegistry
     {
         std::unordered_map<K, V> lookupTable;
-        std::mutex mut;
+        Mutex mut;
 
     public:
         inline bool remove(const K& k)
@@ -79,6 +89,15 @@ namespace detail
         }
     };
 
+    template<class K, class V>
+    using HashMapRegistry = BasicHashMapRegistry<K, V, std::mutex>;
+
+    /**
+     * Registry without locking, for endpoints that are owned by a single thread.
+     */
+    template<class K, class V>
+    using UnsyncedHashMapRegistry = BasicHashMapRegistry<K, V, NullMutex>;
+
     template<class T>
     struct StlAutoPointer: std::unique_ptr<T>
     {
@@ -98,15 +117,24 @@ namespace detail
  * using the STL classes is advisable. This also means that dynamic memory usage is managed by
  * the STL implementation. When tighter control over heap usage is a requirement alternate
  * implementations for the dependencies can be used.
+ *
+ * The registry used for the lookup tables can be replaced, for example endpoints that
+ * are only ever accessed from a single thread can use detail::UnsyncedHashMapRegistry.
+ * Similarly the pointer used to own the invokers can be replaced, for example with
+ * detail::InlinePointer to avoid heap allocation for small callbacks.
  */
-template<class Io>
+template<
+	class Io,
+	template<class, class> class Registry = detail::HashMapRegistry,
+	template<class> class Pointer = detail::StlAutoPointer
+>
 class StlEndpoint:
 	public Io,
 	public Endpoint<
-		detail::StlAutoPointer,
-		detail::HashMapRegistry,
+		Pointer,
+		Registry,
 		typename Io::InputAccessor,
-		StlEndpoint<Io>
+		StlEndpoint<Io, Registry, Pointer>
 	>
 {
 public:
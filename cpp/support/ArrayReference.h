@@ -0,0 +1,91 @@
+#ifndef ROLL_CPP_SUPPORT_ARRAYREFERENCE_H_
+#define ROLL_CPP_SUPPORT_ARRAYREFERENCE_H_
+
+#include "types/CollectionTypeInfoCommon.h"
+
+namespace rpc {
+
+/**
+ * Indirect writer for an array backed collection, which is sent without copying if possible.
+ *
+ * Specifying it as an argument to a remote method invocation makes the elements of
+ * a large block of memory to be sent directly from where they are, if the elements
+ * are encoded as their in-memory representation (see BlockTransfer) and the message
+ * writer supports references (see GrowableMemoryBufferStreamWriter), otherwise it
+ * is serialized like an ArrayWriter.
+ *
+ * NOTE: the memory must stay valid and unchanged until the message is written out,
+ *       which may be later than the return of the call, depending on the transport
+ *       (see the pendingOutput method of FdStreamAdapter and EpollStreamAdapter).
+ */
+template<class T>
+class ArrayReference
+{
+    friend TypeInfo<ArrayReference<T>>;
+    const T* data;
+    uint32_t length;
+
+public:
+    inline ArrayReference() = default;
+
+    /**
+     * Construct from a block of memory.
+     *
+     * A pointer to the first element and the number of elements are needed to be specified.
+     */
+    inline ArrayReference(const T* data, uint32_t length): data(data), length(length) {}
+
+    /**
+     * Construct from a contiguous container (e.g. std::string or std::vector).
+     */
+    template<class C, class = decltype(static_cast<const T*>(((const C*)nullptr)->data()))>
+    inline ArrayReference(const C& c): data(c.data()), length(uint32_t(c.size())) {}
+
+    /**
+     * STL container like size getter.
+     *
+     * Needed for STL compatibility, which allows for reuse of StlCompatibleCollectionTypeBase.
+     */
+    size_t size() const { return length; }
+
+    /**
+     * STL container like begin iterator getter.
+     *
+     * Needed for STL compatibility, which allows for reuse of StlCompatibleCollectionTypeBase.
+     */
+    auto begin() const { return data; }
+
+    /**
+     * STL container like end iterator getter.
+     *
+     * Needed for STL compatibility, which allows for reuse of StlCompatibleCollectionTypeBase.
+     */
+    auto end() const { return data + length; }
+};
+
+template<class C> ArrayReference(const C&) -> ArrayReference<remove_cref_t<decltype(*((const C*)nullptr)->data())>>;
+
+/**
+ * Serialization rules for ArrayReference.
+ */
+template<class T> struct TypeInfo<ArrayReference<T>>: StlCompatibleCollectionTypeBase<ArrayReference<T>, T>
+{
+    template<class A> static inline bool write(A& a, const ArrayReference<T> &v)
+    {
+        if(!VarUint4::write(a, v.length))
+            return false;
+
+        if constexpr(BlockTransfer<T>::template canWrite<A> && detail::canWriteReference((A*)nullptr))
+        {
+            return a.writeReference(v.data, v.length * sizeof(T));
+        }
+        else
+        {
+            return BlockTransfer<T>::write(a, v.data, v.length);
+        }
+    }
+};
+
+}
+
+#endif /* ROLL_CPP_SUPPORT_ARRAYREFERENCE_H_ */
@@ -0,0 +1,177 @@
+#ifndef ROLL_CPP_SUPPORT_ARRAYVIEW_H_
+#define ROLL_CPP_SUPPORT_ARRAYVIEW_H_
+
+#include "types/CollectionTypeInfoCommon.h"
+#include "types/PrimitiveTypeInfo.h"
+
+#include "base/VarInt.h"
+
+#include <type_traits>
+
+#include <cstring>
+
+namespace rpc {
+
+/**
+ * Non-owning view of an array of integral values, used for zero-copy deserialization.
+ *
+ * Trivially encoded values (see BlockTransfer) are stored as their in-memory
+ * representation, so a collection of them can be used directly from the input
+ * buffer, instead of copying it into a container element by element. The data in the buffer is not necessarily aligned,
+ * so the elements are accessed by value.
+ *
+ * Specifying it as an argument of a remotely callable method requires the input accessor
+ * to support borrowing (see PreallocatedMemoryBufferStream::Accessor), the received value
+ * refers to the input buffer, so it must not be used after the invoked method returns.
+ * It can also be used to send an array without copying it into a container first.
+ */
+template<class T>
+class ArrayView
+{
+    static_assert(detail::isTriviallyEncoded<T>(0) && !std::is_same_v<T, bool>, "ArrayView supports trivially encoded element types only");
+
+    const char* data = nullptr;
+    uint32_t length = 0;
+
+    friend struct TypeInfo<ArrayView<T>>;
+
+public:
+    inline ArrayView() = default;
+
+    /**
+     * Construct a view of existing elements.
+     */
+    inline ArrayView(const T* data, uint32_t length): data(reinterpret_cast<const char*>(data)), length(length) {}
+
+    /**
+     * Construct a view of a contiguous container (e.g. std::vector).
+     */
+    template<class C, class = decltype(static_cast<const T*>(((const C*)nullptr)->data()))>
+    inline ArrayView(const C& c): ArrayView(static_cast<const T*>(c.data()), uint32_t(c.size())) {}
+
+    /**
+     * Element access by value.
+     */
+    inline T operator[](size_t idx) const
+    {
+        T ret;
+        memcpy(&ret, data + idx * sizeof(T), sizeof(T));
+        return ret;
+    }
+
+    /**
+     * Copy at most _n_ of the initial elements to the specified location.
+     *
+     * Returns the number of elements copied.
+     */
+    inline size_t copy(T* out, size_t n) const
+    {
+        if(length < n)
+        {
+            n = length;
+        }
+
+        if(!n)
+        {
+            return 0;
+        }
+
+        memcpy(out, data, n * sizeof(T));
+        return n;
+    }
+
+    /**
+     * Iterator that returns the elements by value.
+     */
+    class Iterator
+    {
+        friend ArrayView;
+        const char* ptr;
+
+        inline Iterator(const char* ptr): ptr(ptr) {}
+
+    public:
+        inline T operator*() const
+        {
+            T ret;
+            memcpy(&ret, ptr, sizeof(T));
+            return ret;
+        }
+
+        inline auto& operator++()
+        {
+            ptr += sizeof(T);
+            return *this;
+        }
+
+        inline bool operator!=(const Iterator& o) const { return ptr != o.ptr; }
+    };
+
+    /**
+     * STL container like size getter.
+     *
+     * Needed for STL compatibility, which allows for reuse of StlCompatibleCollectionTypeBase.
+     */
+    inline size_t size() const { return length; }
+
+    /**
+     * STL container like begin iterator getter.
+     *
+     * Needed for STL compatibility, which allows for reuse of StlCompatibleCollectionTypeBase.
+     */
+    inline auto begin() const { return Iterator(data); }
+
+    /**
+     * STL container like end iterator getter.
+     *
+     * Needed for STL compatibility, which allows for reuse of StlCompatibleCollectionTypeBase.
+     */
+    inline auto end() const { return Iterator(data + length * sizeof(T)); }
+};
+
+template<class C> ArrayView(const C&) -> ArrayView<remove_cref_t<decltype(*((const C*)nullptr)->data())>>;
+
+/**
+ * Serialization rules for ArrayView.
+ *
+ * NOTE: see CollectionTypeBase for generic rules of collection serialization.
+ */
+template<class T> struct TypeInfo<ArrayView<T>>: StlCompatibleCollectionTypeBase<ArrayView<T>, T>
+{
+    template<class S> static inline bool write(S& s, const ArrayView<T>& v)
+    {
+        if(!VarUint4::write(s, v.length))
+            return false;
+
+        if constexpr(BlockTransfer<T>::template canWrite<S>)
+        {
+            return s.writeBlock(v.data, v.length * sizeof(T));
+        }
+        else
+        {
+            for(const auto &x: v)
+                if(!TypeInfo<T>::write(s, x))
+                    return false;
+
+            return true;
+        }
+    }
+
+    template<class S> static inline bool read(S& s, ArrayView<T>& v)
+    {
+        uint32_t count;
+        if(!VarUint4::read(s, count))
+            return false;
+
+        const char* data;
+        if(!s.borrow(data, size_t(count) * sizeof(T)))
+            return false;
+
+        v = ArrayView<T>(reinterpret_cast<const T*>(data), count);
+        return true;
+    }
+};
+
+}
+
+#endif /* ROLL_CPP_SUPPORT_ARRAYVIEW_H_ */
@@ -75,16 +75,16 @@ template<class T, size_t n> ArrayWrapper(const T (&v)[n]) -> ArrayWrapper<T, n>;
  */
 template<class T, size_t n> struct TypeInfo<ArrayWrapper<T, n>>: StlCompatibleCollectionTypeBase<ArrayWrapper<T, n>, T>
 {
+    /**
+     * Bounded by the capacity of the wrapper.
+     */
+    static constexpr inline size_t maxSize() {
+        return detail::addSizeBounds(VarUint4::size(n), detail::multiplySizeBound(n, maxSerializedSize<T>()));
+    }
+
     template<class A> static inline bool write(A& a, const ArrayWrapper<T, n> &v)
     {
-        if(!VarUint4::write(a, v.length))
-            return false;
-
-        for(auto i = 0u; i < v.length; i++)
-            if(!TypeInfo<T>::write(a, v.data[i]))
-                return false;
-
-        return true;
+        return VarUint4::write(a, v.length) && BlockTransfer<T>::write(a, v.data, v.length);
     }
 };
 
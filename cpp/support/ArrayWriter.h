@@ -65,14 +65,7 @@ template<class T> struct TypeInfo<ArrayWriter<T>>: StlCompatibleCollectionTypeBa
 {
     template<class A> static inline bool write(A& a, const ArrayWriter<T> &v) 
     { 
-        if(!VarUint4::write(a, v.length))
-            return false;
-
-        for(auto i = 0u; i < v.length; i++)
-            if(!TypeInfo<T>::write(a, v.data[i]))
-                return false;
-
-        return true;    
+        return VarUint4::write(a, v.length) && BlockTransfer<T>::write(a, v.data, v.length);
     }
 };
 
@@ -12,6 +12,10 @@ namespace rpc {
  * read a collection lazily - i.e. without needing its members to be parsed
  * during deserialization. It allows the method to parse the elements of the 
  * collection while iterating through it.
+ *
+ * Elements of constant size can be accessed randomly in constant time, for
+ * collections of variable sized elements a sparse index can be built (see
+ * the index method) to speed up random access, e.g. for binary searching.
  */
 template<class T, class A>
 class StreamReader
@@ -19,6 +23,26 @@ class StreamReader
     A accessor;
     uint32_t length = 0;
 
+    /**
+     * Encoded size of the elements if it is constant, zero otherwise.
+     */
+    static constexpr size_t elementSize = detail::constSizeOf<T>();
+
+    /**
+     * Move the accessor forward by the specified number of elements.
+     */
+    static inline bool advance(A& a, uint32_t n)
+    {
+        if constexpr(elementSize != 0)
+        {
+            return !n || a.skip(size_t(n) * elementSize);
+        }
+        else
+        {
+            return CollectionTypeBase<T>::skipElements(a, n);
+        }
+    }
+
 public:
     inline StreamReader() = default;
 
@@ -145,18 +169,131 @@ public:
     /**
      * Helper that copies at most _n_ of the initial elements from the collection
      *
+     * The elements are copied in bulk if their encoding allows it (see BlockTransfer).
+     *
      * Returns the number of elements copied.
      */
     inline size_t copy(T* out, size_t n) const
     {
-    	size_t idx = 0;
+        if constexpr(BlockTransfer<T>::template canRead<A>)
+        {
+            if(n > length)
+            {
+                n = length;
+            }
 
-    	for(auto it = begin(); (idx < n) && it != end(); idx++, it++)
-    	{
-    		*out++ = *it;
-    	}
+            auto a = accessor;
+            return BlockTransfer<T>::read(a, out, n) ? n : 0;
+        }
+        else
+        {
+            size_t idx = 0;
 
-    	return idx;
+            for(auto it = begin(); (idx < n) && it != end(); idx++, it++)
+            {
+                *out++ = *it;
+            }
+
+            return idx;
+        }
+    }
+
+    /**
+     * Read the element at the specified index.
+     *
+     * Takes constant time for elements of constant size, otherwise the preceding
+     * elements are skipped (see index for faster repeated access).
+     */
+    inline bool read(uint32_t idx, T &v) const
+    {
+        if(idx < length)
+        {
+            auto a = accessor;
+
+            if(advance(a, idx))
+            {
+                return TypeInfo<T>::read(a, v);
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Sparse index of the positions of the elements.
+     *
+     * Stores the position of every _stride_-th element, so that accessing any
+     * element requires skipping at most _stride_ - 1 elements. The stride is
+     * chosen so that the positions fit the fixed capacity of the index, so it
+     * does not need dynamic memory.
+     */
+    template<size_t capacity = 64>
+    class Index
+    {
+        static_assert(capacity > 0);
+
+        friend StreamReader;
+
+        A checkpoints[capacity];
+        uint32_t length = 0, stride = 1, nCheckpoints = 0;
+
+    public:
+        /**
+         * STL-like size getter.
+         */
+        inline auto size() const {
+            return length;
+        }
+
+        /**
+         * Read the element at the specified index.
+         */
+        inline bool read(uint32_t idx, T &v) const
+        {
+            if(idx < length && idx / stride < nCheckpoints)
+            {
+                auto a = checkpoints[idx / stride];
+
+                if(advance(a, idx % stride))
+                {
+                    return TypeInfo<T>::read(a, v);
+                }
+            }
+
+            return false;
+        }
+    };
+
+    /**
+     * Build a sparse index for the collection, by skipping through it once.
+     *
+     * If an element can not be skipped the index is built up to that element.
+     */
+    template<size_t capacity = 64>
+    inline auto index() const
+    {
+        Index<capacity> ret;
+        ret.length = length;
+        ret.stride = (length + capacity - 1) / capacity;
+
+        if(!ret.stride)
+        {
+            ret.stride = 1;
+        }
+
+        auto a = accessor;
+
+        for(uint32_t i = 0; i < length; i += ret.stride)
+        {
+            if(i && !advance(a, ret.stride))
+            {
+                break;
+            }
+
+            ret.checkpoints[ret.nCheckpoints++] = a;
+        }
+
+        return ret;
     }
 };
 
@@ -173,12 +310,7 @@ template<class T, class A> struct TypeInfo<StreamReader<T, A>>: CollectionTypeBa
             return false;
 
         v = StreamReader<T, A>(a, count);
-
-        for(auto i = 0u; i < count; i++)
-            if(!TypeInfo<T>::skip(a))
-                return false;
-
-        return true;    
+        return CollectionTypeBase<T>::skipElements(a, count);
     }
 };
 
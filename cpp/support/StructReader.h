@@ -0,0 +1,213 @@
+#ifndef ROLL_CPP_SUPPORT_STRUCTREADER_H_
+#define ROLL_CPP_SUPPORT_STRUCTREADER_H_
+
+#include "types/StructTypeInfo.h"
+
+namespace rpc {
+
+namespace detail
+{
+	/**
+	 * Compile time information about the members of a struct, as described by its StructTypeInfo.
+	 */
+	template<class Struct, class... Members> struct StructLayout
+	{
+		static constexpr size_t count = sizeof...(Members);
+
+		/**
+		 * Index of the member accessed through the specified member pointer (_count_ if none).
+		 */
+		template<auto mptr> static constexpr inline size_t indexOf()
+		{
+			constexpr bool matches[] = {is_same<Members, StructMember<mptr>>::value..., true};
+
+			size_t ret = 0;
+
+			while(!matches[ret])
+			{
+				ret++;
+			}
+
+			return ret;
+		}
+
+		/**
+		 * Offset of a member from the beginning of the struct if the preceding
+		 * members are all constant size, otherwise unboundedSize.
+		 */
+		template<size_t idx> static constexpr inline size_t constOffset()
+		{
+			constexpr bool isConst[] = {TypeInfo<typename Members::T>::isConstSize()..., false};
+			constexpr size_t sizes[] = {maxSizeOf<TypeInfo<typename Members::T>>(0)..., 0};
+
+			size_t ret = 0;
+
+			for(size_t i = 0; i < idx; i++)
+			{
+				if(!isConst[i] || sizes[i] == unboundedSize)
+				{
+					return unboundedSize;
+				}
+
+				ret += sizes[i];
+			}
+
+			return ret;
+		}
+
+		/**
+		 * Move the accessor past the member with the specified (run time) index.
+		 */
+		template<class A> static inline bool skipMember(size_t idx, A& a)
+		{
+			static constexpr bool (*skippers[])(A&) = {&TypeInfo<typename Members::T>::template skip<A>...};
+			return skippers[idx](a);
+		}
+	};
+
+	template<class Struct, class... Members>
+	StructLayout<Struct, Members...> structLayoutOf(const StructTypeInfo<Struct, Members...>*);
+}
+
+/**
+ * Lazy reader for structs described by StructTypeInfo, used for zero-copy deserialization.
+ *
+ * Specifying it as an argument of a remotely callable method in place of the struct
+ * allows the method to decode only the members it actually uses, directly from the
+ * received message. Members that are preceded only by constant size ones are found
+ * at an offset that is calculated in compile time, the others are located by skipping
+ * the preceding members once, the positions found this way are kept for later accesses.
+ *
+ * Like StreamReader, it refers to the received message, so it must not be used after
+ * the method has returned.
+ */
+template<class Struct, class A>
+class StructReader
+{
+	using Layout = decltype(detail::structLayoutOf((TypeInfo<Struct>*)nullptr));
+
+	/**
+	 * Accessors to the beginning of the members that were already located, in order.
+	 */
+	mutable A positions[Layout::count ? Layout::count : 1];
+
+	/**
+	 * Number of valid entries in _positions_, zero if there is no data.
+	 */
+	mutable size_t nKnown = 0;
+
+	inline bool locate(size_t idx, A& out) const
+	{
+		if(!nKnown)
+			return false;
+
+		while(nKnown <= idx)
+		{
+			auto a = positions[nKnown - 1];
+
+			if(!Layout::skipMember(nKnown - 1, a))
+				return false;
+
+			positions[nKnown++] = a;
+		}
+
+		out = positions[idx];
+		return true;
+	}
+
+public:
+	inline StructReader() = default;
+
+	/**
+	 * Constructor used internally during deserialization.
+	 *
+	 * Stores a stream accessor to the beginning of the first member.
+	 */
+	inline StructReader(const A& accessor): nKnown(1) {
+		positions[0] = accessor;
+	}
+
+	/**
+	 * Decode the member accessed through the specified member pointer.
+	 *
+	 * Returns false if the member could not have been parsed.
+	 */
+	template<auto mptr>
+	inline bool read(typename StructMember<mptr>::T &v) const
+	{
+		constexpr auto idx = Layout::template indexOf<mptr>();
+		static_assert(idx < Layout::count, "not a serialized member of the struct");
+
+		constexpr auto offset = Layout::template constOffset<idx>();
+
+		A a;
+
+		if constexpr(offset != unboundedSize)
+		{
+			if(!nKnown)
+				return false;
+
+			a = positions[0];
+
+			if constexpr(offset != 0)
+			{
+				if(!a.skip(offset))
+					return false;
+			}
+		}
+		else if(!locate(idx, a))
+		{
+			return false;
+		}
+
+		return TypeInfo<typename StructMember<mptr>::T>::read(a, v);
+	}
+
+	/**
+	 * Convenience value access of a member.
+	 *
+	 * Uses the read method, discards the error if there is any. On error returns
+	 * the default constructed value of the member type.
+	 */
+	template<auto mptr>
+	inline auto get() const
+	{
+		typename StructMember<mptr>::T v{};
+		read<mptr>(v);
+		return v;
+	}
+
+	/**
+	 * Decode the whole struct.
+	 */
+	inline bool read(Struct& v) const
+	{
+		if(!nKnown)
+			return false;
+
+		auto a = positions[0];
+		return TypeInfo<Struct>::read(a, v);
+	}
+};
+
+/**
+ * Serialization rules for StructReader.
+ *
+ * It is compatible with the struct itself, reading it only skips over the members.
+ */
+template<class Struct, class A> struct TypeInfo<StructReader<Struct, A>>
+{
+	template<class S> static constexpr inline decltype(auto) writeName(S&& s) { return TypeInfo<Struct>::writeName(s); }
+	template<class S> static inline bool skip(S& s) { return TypeInfo<Struct>::skip(s); }
+	static constexpr inline bool isConstSize() { return TypeInfo<Struct>::isConstSize(); }
+
+	static inline bool read(A& a, StructReader<Struct, A> &v)
+	{
+		v = StructReader<Struct, A>(a);
+		return TypeInfo<Struct>::skip(a);
+	}
+};
+
+}
+
+#endif /* ROLL_CPP_SUPPORT_STRUCTREADER_H_ */
@@ -22,6 +22,10 @@ template<class... Types> struct AggregateTypeBase
         return (TypeInfo<Types>::skip(s) && ... && true);
     }
 
+	static constexpr inline size_t maxSize() {
+        return maxSerializedSize<Types...>();
+	}
+
 	static constexpr inline bool isConstSize() {
         return (TypeInfo<Types>::isConstSize() && ... && true);
 	}
@@ -1,9 +1,7 @@
 #ifndef ROLL_CPP_TYPES_ARRAYTYPEINFO_H_
 #define ROLL_CPP_TYPES_ARRAYTYPEINFO_H_
 
-#include "Collection.h"
-
-#include "base/VarInt.h"
+#include "CollectionTypeInfoCommon.h"
 
 namespace rpc {
 
@@ -16,6 +14,10 @@ template<class T, size_t n> struct TypeInfo<T[n]>: CollectionPlaceholder<remove_
 {
 	static constexpr inline bool isConstSize() { return TypeInfo<T>::isConstSize(); }
 
+	static constexpr inline size_t maxSize() {
+		return detail::addSizeBounds(VarUint4::size(n), detail::multiplySizeBound(n, maxSerializedSize<T>()));
+	}
+
     static constexpr inline size_t size(const T(&v)[n])
     {
         size_t contentSize = 0;
@@ -35,20 +37,7 @@ template<class T, size_t n> struct TypeInfo<T[n]>: CollectionPlaceholder<remove_
 
 	template<class S> static inline bool write(S& s, const T(&v)[n])
 	{
-		if(VarUint4::write(s, n))
-		{
-			for(const auto &x: v)
-			{
-				if(!TypeInfo<T>::write(s, x))
-				{
-					return false;
-				}
-			}
-
-			return true;
-		}
-
-		return false;
+		return VarUint4::write(s, n) && BlockTransfer<remove_const_t<T>>::write(s, v, n);
 	}
 
 	template<class S> static inline bool read(S& s, T(&v)[n])
@@ -58,15 +47,7 @@ template<class T, size_t n> struct TypeInfo<T[n]>: CollectionPlaceholder<remove_
 		{
 			if(count == n)
 			{
-				for(auto& x: v)
-				{
-					if(!TypeInfo<T>::read(s, x))
-					{
-						return false;
-					}
-				}
-
-				return true;
+				return BlockTransfer<T>::read(s, v, n);
 			}
 		}
 
@@ -20,7 +20,9 @@ template<class... Args> struct TypeInfo<Call<Args...>>
 	template<class S> static inline bool read(S& s, Call<Args...> &v) { return ::rpc::VarUint4::read(s, v.id); }
 	template<class S> static inline bool skip(S& s) { return ::rpc::VarUint4::skip(s); }
 	static constexpr inline size_t size(const Call<Args...> &v) { return ::rpc::VarUint4::size(v.id); }
+	static constexpr inline size_t maxSize() { return ::rpc::VarUint4::maxLength; }
 	static constexpr inline bool isConstSize() { return false; }
+	static constexpr inline bool isVarUint4Encoded() { return true; }
 };
 
 }
@@ -7,6 +7,58 @@
 
 namespace rpc {
 
+namespace detail
+{
+	template<class T> static constexpr inline auto isTriviallyEncoded(int) -> decltype(TypeInfo<T>::isTriviallyEncoded()) {
+		return TypeInfo<T>::isTriviallyEncoded();
+	}
+
+	template<class T> static constexpr inline bool isTriviallyEncoded(...) { return false; }
+
+	template<class T> static constexpr inline auto isVarUint4Encoded(int) -> decltype(TypeInfo<T>::isVarUint4Encoded()) {
+		return TypeInfo<T>::isVarUint4Encoded();
+	}
+
+	template<class T> static constexpr inline bool isVarUint4Encoded(...) { return false; }
+
+	/**
+	 * The encoded size of all values of the type if it is the same for all of them
+	 * and known in compile time, zero otherwise.
+	 */
+	template<class T> static constexpr inline size_t constSizeOf()
+	{
+		if constexpr(TypeInfo<T>::isConstSize())
+		{
+			constexpr auto ret = maxSizeOf<TypeInfo<T>>(0);
+
+			if constexpr(ret != unboundedSize)
+			{
+				return ret;
+			}
+		}
+
+		return 0;
+	}
+
+	/**
+	 * Lower bound of the encoded size of values of the type.
+	 *
+	 * Values of variable size types take at least one byte, constant size
+	 * types of unknown size are assumed to take none.
+	 */
+	template<class T> static constexpr inline size_t minSizeOf()
+	{
+		if constexpr(TypeInfo<T>::isConstSize())
+		{
+			return constSizeOf<T>();
+		}
+		else
+		{
+			return 1;
+		}
+	}
+}
+
 /**
  * Common serialization rules for all collection objects.
  *
@@ -15,22 +67,113 @@ namespace rpc {
  */
 template<class T> struct CollectionTypeBase: CollectionPlaceholder<T>
 {
+	/**
+	 * Check that the specified number of elements can be present in the rest of the message.
+	 *
+	 * Used before allocating storage for the elements, so that a malformed message
+	 * can not trigger huge allocations. The check is done once per collection, if
+	 * the accessor can tell the length of the remaining data.
+	 */
+	template<class S> static inline bool checkCount(const S& s, uint32_t count)
+	{
+		constexpr auto minSize = detail::minSizeOf<T>();
+
+		if constexpr(minSize != 0 && detail::hasContiguous((S*)nullptr))
+		{
+			size_t length;
+			s.contiguous(length);
+			return count <= length / minSize;
+		}
+		else
+		{
+			return true;
+		}
+	}
+
+	/**
+	 * Skip the specified number of elements.
+	 *
+	 * Elements of constant size are skipped without parsing them, elements that are
+	 * encoded as a single variable length value (e.g. Call objects) are skipped in
+	 * one go, if the accessor allows that (see VarUint4::skip).
+	 */
+	template<class S> static inline bool skipElements(S& s, uint32_t count)
+	{
+		if constexpr(constexpr auto elementSize = detail::constSizeOf<T>(); elementSize != 0)
+		{
+			return s.skip(size_t(count) * elementSize);
+		}
+		else if constexpr(detail::isVarUint4Encoded<T>(0))
+		{
+			return ::rpc::VarUint4::skip(s, count);
+		}
+		else
+		{
+			while(count--)
+				if(!TypeInfo<T>::skip(s))
+					return false;
+
+			return true;
+		}
+	}
+
 	template<class S> static inline bool skip(S& s)
     {
         uint32_t count;
         if(!::rpc::VarUint4::read(s, count))
             return false;
 
-        while(count--)
-            if(!TypeInfo<T>::skip(s))
-                return false;
-
-        return true;
+        return skipElements(s, count);
     }
 
 	static constexpr inline bool isConstSize() { return false; }
 };
 
+/**
+ * Transfer of the elements of a contiguous array.
+ *
+ * If the encoding of the element type is the same as its in-memory representation
+ * (see PrimitveIntegerTypeInfoBase) and the accessor supports it, the whole array
+ * is copied in one go, otherwise the elements are serialized one by one.
+ */
+template<class T> struct BlockTransfer
+{
+	template<class S> static constexpr bool canWrite = detail::isTriviallyEncoded<T>(0) && detail::canWriteBlock((S*)nullptr);
+	template<class S> static constexpr bool canRead = detail::isTriviallyEncoded<T>(0) && detail::canReadBlock((S*)nullptr);
+
+	template<class S> static inline bool write(S& s, const T* data, size_t n)
+	{
+		if constexpr(canWrite<S>)
+		{
+			return !n || s.writeBlock(data, n * sizeof(T));
+		}
+		else
+		{
+			while(n--)
+				if(!TypeInfo<T>::write(s, *data++))
+					return false;
+
+			return true;
+		}
+	}
+
+	template<class S> static inline bool read(S& s, T* data, size_t n)
+	{
+		if constexpr(canRead<S>)
+		{
+			return !n || s.readBlock(data, n * sizeof(T));
+		}
+		else
+		{
+			while(n--)
+				if(!TypeInfo<T>::read(s, *data++))
+					return false;
+
+			return true;
+		}
+	}
+};
+
 /**
  * Common serialization rules for STL-like containers.
  *
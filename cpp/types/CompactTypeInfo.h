@@ -0,0 +1,59 @@
+#ifndef ROLL_CPP_TYPES_COMPACTTYPEINFO_H_
+#define ROLL_CPP_TYPES_COMPACTTYPEINFO_H_
+
+#include "TypeInfo.h"
+
+#include "base/VarInt.h"
+
+namespace rpc {
+
+/**
+ * Integer value sent using variable length encoding.
+ *
+ * Can be used in place of a 64 bit value that is usually small (counters, time differences)
+ * to avoid sending the zero bytes of the full width encoding. It converts implicitly to and
+ * from the underlying type, which can be either uint64_t or int64_t (zigzag encoded).
+ */
+template<class T>
+struct Compact
+{
+	T value = 0;
+
+	inline constexpr Compact() = default;
+	inline constexpr Compact(T value): value(value) {}
+	inline constexpr operator T() const { return value; }
+};
+
+/**
+ * General serialization rules for variable length encoded integer values.
+ */
+template<class T, class Coder, char prefix> struct CompactTypeInfoBase
+{
+	static constexpr const char sgn[3] = {prefix, '0' + (char)sizeof(T), '\0'};
+
+	template<class S> static constexpr inline decltype(auto) writeName(S&& s) { return s << sgn; }
+	template<class S> static inline bool write(S& s, const Compact<T> &v) { return Coder::write(s, v.value); }
+	template<class S> static inline bool read(S& s, Compact<T> &v) { return Coder::read(s, v.value); }
+	template<class S> static inline bool skip(S& s) { return Coder::skip(s); }
+	static constexpr inline size_t size(const Compact<T> &v) { return Coder::size(v.value); }
+	static constexpr inline size_t maxSize() { return Coder::maxLength; }
+	static constexpr inline bool isConstSize() { return false; }
+};
+
+/**
+ * Serialization rules for variable length encoded unsigned 64 bit values.
+ *
+ * The value is encoded as 1-10 bytes using LEB128 (see VarUint8).
+ */
+template<> struct TypeInfo<Compact<uint64_t>>: CompactTypeInfoBase<uint64_t, VarUint8, 'v'> {};
+
+/**
+ * Serialization rules for variable length encoded signed 64 bit values.
+ *
+ * The value is zigzag encoded, then written as 1-10 bytes using LEB128 (see VarInt8).
+ */
+template<> struct TypeInfo<Compact<int64_t>>: CompactTypeInfoBase<int64_t, VarInt8, 'z'> {};
+
+}
+
+#endif /* ROLL_CPP_TYPES_COMPACTTYPEINFO_H_ */
@@ -1,6 +1,8 @@
 #ifndef ROLL_CPP_TYPES_DEREFERENCETYPEINFO_H_
 #define ROLL_CPP_TYPES_DEREFERENCETYPEINFO_H_
 
+#include "TypeInfo.h"
+
 #include <cstddef>
 
 namespace rpc
@@ -13,6 +15,7 @@ template<class Info> struct DereferenceTypeInfo
 	template<class S, class Type> static inline bool read(S& s, Type v) { return Info::read(s, *v); }
 	template<class Type> static constexpr inline size_t size(Type v) { return Info::size(*v); }
 	template<class S> static inline bool skip(S& s) { return Info::skip(s); }
+	static constexpr inline size_t maxSize() { return detail::maxSizeOf<Info>(0); }
 	static constexpr inline bool isConstSize() { return Info::isConstSize(); }
 };
 
@@ -24,7 +24,16 @@ template<class T, char prefix> struct PrimitveIntegerTypeInfoBase
 	template<class S> static inline bool read(S& s, T &v) { return s.read(v); }
 	template<class S> static inline bool skip(S& s) { return s.skip(sizeof(T)); }
 	static constexpr inline size_t size(...) { return sizeof(T); }
+	static constexpr inline size_t maxSize() { return sizeof(T); }
 	static constexpr inline bool isConstSize() { return true; }
+
+	/**
+	 * The encoding is the same as the in-memory representation on little endian hosts,
+	 * so arrays of these can be copied in bulk (see BlockTransfer).
+	 */
+	static constexpr inline bool isTriviallyEncoded() {
+		return sizeof(T) == 1 || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+	}
 };
 
 /**
@@ -113,9 +122,20 @@ template<> struct TypeInfo<bool> {
 	static_assert(sizeof(bool) == 1);
 	template<class S> static constexpr inline decltype(auto) writeName(S&& s) { return s << "b"; }
 	template<class S> static inline bool write(S& s, const bool &v) { return s.write(v); }
-	template<class S> static inline bool read(S& s, bool &v) { return s.read(v); }
+	template<class S> static inline bool read(S& s, bool &v)
+	{
+		uint8_t x;
+
+		if(!s.read(x) || x > 1)
+			return false;
+
+		v = x;
+		return true;
+	}
+
 	template<class S> static inline bool skip(S& s) { return s.skip(1); }
 	static constexpr inline size_t size(...) { return 1; }
+	static constexpr inline size_t maxSize() { return 1; }
 	static constexpr inline bool isConstSize() { return true; }
 };
 
@@ -0,0 +1,44 @@
+#ifndef ROLL_CPP_TYPES_STDSTRINGVIEWTYPEINFO_H_
+#define ROLL_CPP_TYPES_STDSTRINGVIEWTYPEINFO_H_
+
+#include "CollectionTypeInfoCommon.h"
+
+#include <string_view>
+
+namespace rpc {
+
+/**
+ * Serialization rules for std::string_view.
+ *
+ * It is written the same way as a std::string, but reading it does not copy the
+ * characters, the view refers to the input buffer directly. This requires the
+ * input accessor to support borrowing (see PreallocatedMemoryBufferStream::Accessor)
+ * and the received value must not be used after the invoked method returns.
+ *
+ * NOTE: see CollectionTypeBase for generic rules of collection serialization.
+ */
+template<> struct TypeInfo<std::string_view>: StlCompatibleCollectionTypeBase<std::string_view, char>
+{
+    template<class S> static inline bool write(S& s, const std::string_view& v)
+    {
+        return VarUint4::write(s, v.size()) && BlockTransfer<char>::write(s, v.data(), v.size());
+    }
+
+    template<class S> static inline bool read(S& s, std::string_view& v)
+    {
+        uint32_t count;
+        if(!VarUint4::read(s, count))
+            return false;
+
+        const char* data;
+        if(!s.borrow(data, count))
+            return false;
+
+        v = std::string_view(data, count);
+        return true;
+    }
+};
+
+}
+
+#endif /* ROLL_CPP_TYPES_STDSTRINGVIEWTYPEINFO_H_ */
@@ -33,7 +33,7 @@ template<class C, class T> struct StlCollection: StlCompatibleCollectionTypeBase
     template<class S, class A> static inline bool read(S& s, C& v, A&& a)
     { 
         uint32_t count;
-        if(!VarUint4::read(s, count))
+        if(!VarUint4::read(s, count) || !StlCollection::checkCount(s, count))
             return false;
 
         v.clear();
@@ -77,12 +77,36 @@ template<class C, class T> struct StlAssociativeCollection: StlCollection<C, T>
  */
 template<class C, class T> struct StlArrayBasedCollection: StlCollection<C, T> 
 {
+    template<class S> static inline bool write(S& s, const C& v)
+    {
+        if constexpr(BlockTransfer<T>::template canWrite<S>)
+        {
+            return VarUint4::write(s, v.size()) && BlockTransfer<T>::write(s, v.data(), v.size());
+        }
+        else
+        {
+            return StlArrayBasedCollection::StlCollection::write(s, v);
+        }
+    }
+
     template<class S> static inline bool read(S& s, C& v) 
     { 
-        return StlArrayBasedCollection::StlCollection::read(s, v, [](uint32_t count, C& v){
-            v.reserve(count);
-            return std::back_insert_iterator<C>(v);
-        });
+        if constexpr(BlockTransfer<T>::template canRead<S>)
+        {
+            uint32_t count;
+            if(!VarUint4::read(s, count) || !StlArrayBasedCollection::checkCount(s, count))
+                return false;
+
+            v.resize(count);
+            return BlockTransfer<T>::read(s, v.data(), count);
+        }
+        else
+        {
+            return StlArrayBasedCollection::StlCollection::read(s, v, [](uint32_t count, C& v){
+                v.reserve(count);
+                return std::back_insert_iterator<C>(v);
+            });
+        }
     }
 };
 
@@ -8,6 +8,40 @@ namespace rpc {
 
 template<class> struct TypeInfo;
 
+/**
+ * Value of the maximal serialized size of types that have no upper bound on it.
+ */
+static constexpr size_t unboundedSize = ~size_t(0);
+
+namespace detail
+{
+	template<class Info> static constexpr inline auto maxSizeOf(int) -> decltype(Info::maxSize()) { return Info::maxSize(); }
+	template<class Info> static constexpr inline size_t maxSizeOf(...) { return unboundedSize; }
+
+	static constexpr inline size_t addSizeBounds(size_t a, size_t b) {
+		return (a == unboundedSize || b == unboundedSize) ? unboundedSize : a + b;
+	}
+
+	static constexpr inline size_t multiplySizeBound(size_t n, size_t b) {
+		return (b == unboundedSize || (b && n > unboundedSize / b)) ? unboundedSize : n * b;
+	}
+}
+
+/**
+ * Upper bound - computed in compile time - of the total serialized size of values of the specified types.
+ *
+ * The bound is taken from the maxSize method of the TypeInfo of each type, types that do
+ * not provide it are considered to be unbounded and so is the result if any of them is.
+ * For types that are constant size (isConstSize) the bound is also the exact size.
+ */
+template<class... Ts>
+static constexpr inline size_t maxSerializedSize()
+{
+	size_t ret = 0;
+	((ret = detail::addSizeBounds(ret, detail::maxSizeOf<TypeInfo<remove_cref_t<Ts>>>(0))), ...);
+	return ret;
+}
+
 /**
  * Checks - in compile time - that two types are compatible serialization-wise.
  */
@@ -0,0 +1,61 @@
+#include "FuzzEndpoint.h"
+
+#include <memory>
+
+/**
+ * Fuzz target for the framing of the received byte stream.
+ *
+ * The first byte of the input selects the size of the chunks the rest is fed
+ * to a ReceiveBuffer in (as if it came from separate read calls), the complete
+ * frames are processed by the endpoint until an invalid header is found or a
+ * message is rejected. A small buffer and frame length limit is used, so that
+ * the growing of the buffer is exercised as well.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if(!size)
+    {
+        return 0;
+    }
+
+    auto &ep = fuzz::endpoint();
+    const size_t chunkSize = 1 + data[0] % 64;
+    data++;
+    size--;
+
+    rpc::ReceiveBuffer rx;
+    rx.resize(32);
+    rx.setMaxFrameLength(64 * 1024);
+
+    while(size)
+    {
+        size_t length;
+        auto ptr = rx.freeSpace(length);
+
+        if(length > chunkSize)
+            length = chunkSize;
+
+        if(length > size)
+            length = size;
+
+        memcpy(ptr, data, length);
+        rx.commit(length);
+        data += length;
+        size -= length;
+
+        size_t count;
+        auto ok = rx.dispatch([&ep](rpc::PreallocatedMemoryBufferStream&& s)
+        {
+            auto a = s.access();
+            auto err = ep.process(a);
+            return rpc::getExpectedExecutorBehavior(err) != rpc::ExpectedExecutorBehavior::Die;
+        }, count);
+
+        if(!ok)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+#ifndef ROLL_FUZZ_FUZZENDPOINT_H_
+#define ROLL_FUZZ_FUZZENDPOINT_H_
+
+#include "platform/FdStreamAdapter.h"
+#include "platform/StlAdapters.h"
+
+#include "support/StreamReader.h"
+#include "support/StructReader.h"
+#include "support/ArrayView.h"
+
+#include "types/ArrayTypeInfo.h"
+#include "types/CompactTypeInfo.h"
+#include "types/StructTypeInfo.h"
+#include "types/StdStringTypeInfo.h"
+#include "types/StdStringViewTypeInfo.h"
+#include "types/StdVectorTypeInfo.h"
+#include "types/StdListTypeInfo.h"
+#include "types/StdDequeTypeInfo.h"
+#include "types/StdForwardListTypeInfo.h"
+#include "types/StdMapTypeInfo.h"
+#include "types/StdMultimapTypeInfo.h"
+#include "types/StdSetTypeInfo.h"
+#include "types/StdMultisetTypeInfo.h"
+#include "types/StdUnorderedMapTypeInfo.h"
+#include "types/StdUnorderedMultimapTypeInfo.h"
+#include "types/StdUnorderedSetTypeInfo.h"
+#include "types/StdUnorderedMultisetTypeInfo.h"
+#include "types/StdPairTypeInfo.h"
+#include "types/StdTupleTypeInfo.h"
+
+#include <deque>
+
+/**
+ * Shared setup of the fuzz targets: an endpoint that provides methods taking
+ * all of the supported kinds of arguments, on top of an IO engine that does
+ * not do any IO at all.
+ */
+
+/**
+ * IO engine that drops the sent messages or collects their payloads if requested.
+ *
+ * The received messages are fed directly to the process method by the fuzz targets.
+ */
+class FuzzIo
+{
+public:
+    using InputAccessor = rpc::PreallocatedMemoryBufferStream::Accessor;
+
+    /**
+     * Payloads of the sent messages are appended here, if set.
+     */
+    std::deque<std::vector<char>>* capture = nullptr;
+
+    inline auto messageFactory() {
+        return rpc::PreallocatedMemoryBufferStreamWriterFactory{};
+    }
+
+    inline bool send(rpc::PreallocatedMemoryBufferStream&& s)
+    {
+        if(capture)
+        {
+            auto a = s.access();
+            capture->emplace_back(a.ptr, a.end);
+        }
+
+        return true;
+    }
+};
+
+using FuzzEndpoint = rpc::StlEndpoint<FuzzIo>;
+using FuzzAccessor = FuzzIo::InputAccessor;
+
+struct FuzzRecord
+{
+    int a;
+    std::string s;
+    bool f;
+    std::vector<rpc::Compact<int64_t>> v;
+};
+
+namespace rpc {
+
+template<> struct TypeInfo<FuzzRecord>: StructTypeInfo<FuzzRecord,
+    StructMember<&FuzzRecord::a>,
+    StructMember<&FuzzRecord::s>,
+    StructMember<&FuzzRecord::f>,
+    StructMember<&FuzzRecord::v>
+> {};
+
+}
+
+namespace fuzz {
+
+static constexpr auto m1 = rpc::symbol<std::vector<std::string>, std::map<int, std::list<bool>>, std::multimap<short, std::deque<char>>>("containers"_ctstr);
+static constexpr auto m2 = rpc::symbol<std::set<std::string>, std::multiset<int>, std::unordered_map<uint64_t, std::vector<int>>, std::unordered_multimap<int, int>>("associative"_ctstr);
+static constexpr auto m3 = rpc::symbol<std::unordered_set<std::string>, std::unordered_multiset<char>, std::forward_list<std::pair<int, std::string>>, std::tuple<int, bool, std::string>>("unordered"_ctstr);
+static constexpr auto m4 = rpc::symbol<rpc::CollectionPlaceholder<std::string>, rpc::CollectionPlaceholder<int>, FuzzRecord, rpc::CollectionPlaceholder<uint32_t>, std::string>("lazy"_ctstr);
+static constexpr auto m5 = rpc::symbol<FuzzRecord, int[3], rpc::Compact<uint64_t>, rpc::Call<std::string, rpc::Call<int>>, std::vector<rpc::Call<int>>>("nested"_ctstr);
+static constexpr auto m6 = rpc::symbol<rpc::ArrayView<char>, rpc::ArrayView<int16_t>>("views"_ctstr);
+
+/**
+ * Register the fuzzed methods.
+ *
+ * The handlers touch all of the decoded data (the lazy readers are only parsed
+ * on access) and call back through the received Call objects.
+ */
+inline bool provideAll(FuzzEndpoint& ep)
+{
+    using namespace rpc;
+
+    return ep.provide(m1, [](FuzzEndpoint&, MethodHandle, std::vector<std::string>, std::map<int, std::list<bool>>, std::multimap<short, std::deque<char>>) {}) == Errors::success
+    && ep.provide(m2, [](FuzzEndpoint&, MethodHandle, std::set<std::string>, std::multiset<int>, std::unordered_map<uint64_t, std::vector<int>>, std::unordered_multimap<int, int>) {}) == Errors::success
+    && ep.provide(m3, [](FuzzEndpoint&, MethodHandle, std::unordered_set<std::string>, std::unordered_multiset<char>, std::forward_list<std::pair<int, std::string>>, std::tuple<int, bool, std::string>) {}) == Errors::success
+    && ep.provide(m4, [](FuzzEndpoint&, MethodHandle, StreamReader<std::string, FuzzAccessor> strs, StreamReader<int, FuzzAccessor> ints,
+                         StructReader<FuzzRecord, FuzzAccessor> rec, ArrayView<uint32_t> view, std::string_view sv)
+        {
+            for(const auto &s: strs)
+                (void)s;
+
+            if(auto idx = strs.index<4>(); strs.size())
+            {
+                std::string last;
+                idx.read(strs.size() - 1, last);
+            }
+
+            int mid;
+            ints.read(ints.size() / 2, mid);
+            std::vector<int> all(ints.size());
+            ints.copy(all.data(), all.size());
+
+            rec.get<&FuzzRecord::v>();
+            rec.get<&FuzzRecord::f>();
+            FuzzRecord r;
+            rec.read(r);
+
+            uint32_t sum = 0;
+            for(auto x: view)
+                sum += x;
+
+            (void)sum;
+            (void)sv;
+        }) == Errors::success
+    && ep.provide(m5, [](FuzzEndpoint& ep, MethodHandle, FuzzRecord r, std::vector<int> arr, Compact<uint64_t>, Call<std::string, Call<int>> cb, std::vector<Call<int>> cbs)
+        {
+            if(!cbs.empty())
+                ep.call(cb, r.s, cbs.front());
+
+            for(const auto &c: cbs)
+                ep.call(c, arr.empty() ? r.a : arr.front());
+        }) == Errors::success
+    && ep.provide(m6, [](FuzzEndpoint&, MethodHandle, ArrayView<char> bytes, ArrayView<int16_t> shorts)
+        {
+            std::string copy(bytes.size(), '\0');
+            bytes.copy(copy.data(), copy.size());
+
+            int sum = 0;
+            for(auto x: shorts)
+                sum += x;
+
+            (void)sum;
+        }) == Errors::success;
+}
+
+/**
+ * The endpoint used by the fuzz targets, set up once and reused for all inputs,
+ * as the methods it provides do not accumulate state.
+ */
+inline FuzzEndpoint& endpoint()
+{
+    static FuzzEndpoint ep;
+    static const bool ok = provideAll(ep);
+
+    if(!ok)
+    {
+        abort();
+    }
+
+    return ep;
+}
+
+}
+
+#endif /* ROLL_FUZZ_FUZZENDPOINT_H_ */
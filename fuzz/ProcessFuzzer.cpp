@@ -0,0 +1,30 @@
+#include "FuzzEndpoint.h"
+
+#include <memory>
+
+/**
+ * Fuzz target for the processing of a single received message.
+ *
+ * The input is the payload of a frame (without the header), it is handed to the
+ * endpoint the same way as the stream adapters do.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    auto &ep = fuzz::endpoint();
+
+    /*
+     * Copied to a buffer of the exact size, so that any read past the end of the
+     * message is caught by the address sanitizer, and because the accessor (and
+     * thus the borrowing readers) refer to mutable memory.
+     */
+    std::unique_ptr<char[]> message(new char[size]);
+
+    if(size)
+    {
+        memcpy(message.get(), data, size);
+    }
+
+    FuzzAccessor a(message.get(), message.get() + size);
+    ep.process(a);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+/**
+ * Fallback driver for the fuzz targets, for compilers without libFuzzer (e.g. gcc).
+ *
+ * It does not generate new inputs, just runs the target on the specified files,
+ * or on all the files in the specified directories (i.e. a corpus), so that the
+ * targets are built and the corpora are checked (with the sanitizers enabled)
+ * as part of the regular build.
+ */
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static bool replayFile(const std::string& path)
+{
+    auto f = fopen(path.c_str(), "rb");
+
+    if(!f)
+    {
+        fprintf(stderr, "could not open %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> input;
+    uint8_t buffer[4096];
+
+    while(auto n = fread(buffer, 1, sizeof(buffer), f))
+    {
+        input.insert(input.end(), buffer, buffer + n);
+    }
+
+    fclose(f);
+
+    /*
+     * Copied to a buffer of the exact size, so that reads past the end are caught.
+     */
+    std::vector<uint8_t> exact(input);
+    LLVMFuzzerTestOneInput(exact.data(), exact.size());
+    return true;
+}
+
+static bool replay(const std::string& path, size_t& count)
+{
+    struct stat st;
+
+    if(stat(path.c_str(), &st))
+    {
+        fprintf(stderr, "could not access %s\n", path.c_str());
+        return false;
+    }
+
+    if(!S_ISDIR(st.st_mode))
+    {
+        count++;
+        return replayFile(path);
+    }
+
+    auto dir = opendir(path.c_str());
+
+    if(!dir)
+    {
+        fprintf(stderr, "could not open %s\n", path.c_str());
+        return false;
+    }
+
+    bool ok = true;
+
+    while(auto e = readdir(dir))
+    {
+        if(e->d_name[0] != '.')
+        {
+            ok = replay(path + "/" + e->d_name, count) && ok;
+        }
+    }
+
+    closedir(dir);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s <file or directory>...\n", argv[0]);
+        return 1;
+    }
+
+    bool ok = true;
+    size_t count = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        ok = replay(argv[i], count) && ok;
+    }
+
+    printf("replayed %zu inputs\n", count);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include "FuzzEndpoint.h"
+
+#include <cstdio>
+#include <string>
+
+/**
+ * Initial corpus generator for the fuzz targets.
+ *
+ * An endpoint talks to itself: it looks up each of the fuzzed methods and calls
+ * them with valid arguments, each sent message is processed by the same endpoint
+ * and also saved as a seed. The message payloads are written into the first
+ * directory (for ProcessFuzzer), the framed messages into the second one (for
+ * FrameFuzzer, prefixed with the chunk size selector byte).
+ */
+
+static bool save(const std::string& path, const std::vector<char>& data)
+{
+    auto f = fopen(path.c_str(), "wb");
+
+    if(!f)
+    {
+        return false;
+    }
+
+    const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static std::vector<char> frame(const std::vector<char>& payload, char selector)
+{
+    char header[rpc::VarUint4::maxLength];
+    FuzzAccessor a(header, header + sizeof(header));
+    rpc::VarUint4::write(a, uint32_t(rpc::PreallocatedMemoryBufferStream::frameLength(payload.size())));
+
+    std::vector<char> ret{selector};
+    ret.insert(ret.end(), header, a.ptr);
+    ret.insert(ret.end(), payload.begin(), payload.end());
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    using namespace rpc;
+
+    if(argc != 3)
+    {
+        fprintf(stderr, "usage: %s <process corpus dir> <frame corpus dir>\n", argv[0]);
+        return 1;
+    }
+
+    std::deque<std::vector<char>> sent;
+    FuzzEndpoint ep;
+
+    if(!fuzz::provideAll(ep))
+    {
+        return 1;
+    }
+
+    ep.capture = &sent;
+
+    ep.lookup(fuzz::m1, [](FuzzEndpoint& ep, bool, decltype(fuzz::m1)::CallType c)
+    {
+        ep.call(c, std::vector<std::string>{"ab", "", "cde"},
+            std::map<int, std::list<bool>>{{1, {true, false}}, {7, {}}},
+            std::multimap<short, std::deque<char>>{{1, {'a'}}, {1, {'b', 'c'}}});
+    });
+
+    ep.lookup(fuzz::m2, [](FuzzEndpoint& ep, bool, decltype(fuzz::m2)::CallType c)
+    {
+        ep.call(c, std::set<std::string>{"x", "yy"}, std::multiset<int>{1, 1, 2},
+            std::unordered_map<uint64_t, std::vector<int>>{{5, {1, 2}}},
+            std::unordered_multimap<int, int>{{1, 2}, {1, 3}});
+    });
+
+    ep.lookup(fuzz::m3, [](FuzzEndpoint& ep, bool, decltype(fuzz::m3)::CallType c)
+    {
+        ep.call(c, std::unordered_set<std::string>{"q"}, std::unordered_multiset<char>{'a', 'a'},
+            std::forward_list<std::pair<int, std::string>>{{1, "one"}, {2, "two"}},
+            std::tuple<int, bool, std::string>{3, true, "t"});
+    });
+
+    ep.lookup(fuzz::m4, [](FuzzEndpoint& ep, bool, decltype(fuzz::m4)::CallType c)
+    {
+        ep.call(c, std::vector<std::string>{"a", "bb", "ccc", "dddd", "e"}, std::vector<int>{1, 2, 3, 4},
+            FuzzRecord{1, "r", true, {-1, 1000000}}, std::vector<uint32_t>{9, 8}, std::string("view"));
+    });
+
+    ep.lookup(fuzz::m5, [](FuzzEndpoint& ep, bool, decltype(fuzz::m5)::CallType c)
+    {
+        const int arr[3] = {1, 2, 3};
+        auto cb = ep.install([](FuzzEndpoint&, MethodHandle, std::string, Call<int>) {});
+        auto cb2 = ep.install([](FuzzEndpoint&, MethodHandle, int) {});
+        ep.call(c, FuzzRecord{2, "s", false, {5}}, arr, Compact<uint64_t>(300), cb, std::vector<Call<int>>{cb2, cb2});
+    });
+
+    ep.lookup(fuzz::m6, [](FuzzEndpoint& ep, bool, decltype(fuzz::m6)::CallType c)
+    {
+        const std::string bytes("bytes");
+        const std::vector<int16_t> shorts{-1, 2, 300};
+        ep.call(c, ArrayView<char>(bytes), ArrayView<int16_t>(shorts));
+    });
+
+    ep.lookupAll([](FuzzEndpoint&, bool, decltype(fuzz::m1)::CallType, decltype(fuzz::m5)::CallType) {}, fuzz::m1, fuzz::m5);
+
+    std::vector<char> all{0};
+
+    for(size_t n = 0; !sent.empty(); n++)
+    {
+        auto payload = std::move(sent.front());
+        sent.pop_front();
+
+        const auto name = "/seed-" + std::to_string(n);
+        const auto framed = frame(payload, char(n));
+
+        if(!save(argv[1] + name, payload) || !save(argv[2] + name, framed))
+        {
+            fprintf(stderr, "could not write seed %zu\n", n);
+            return 1;
+        }
+
+        all.insert(all.end(), framed.begin() + 1, framed.end());
+
+        FuzzAccessor a(payload.data(), payload.data() + payload.size());
+
+        if(ep.process(a) != Errors::success)
+        {
+            fprintf(stderr, "seed %zu was not processed successfully\n", n);
+            return 1;
+        }
+    }
+
+    return save(argv[2] + std::string("/seed-all"), all) ? 0 : 1;
+}